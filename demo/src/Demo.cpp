@@ -18,7 +18,7 @@ static void printCharstring(const Charstring& cs) {
     for (auto i : cs) {
         switch (i.type) {
             case PS_OPERATOR:
-                std::cout << i.str << " ";
+                std::cout << i.str() << " ";
                 break;
             case PS_OPERAND:
                 std::cout << i.num << " ";
@@ -156,7 +156,7 @@ void Demo::drawPaths(const PathList& paths) {
 
 void Demo::drawPath(const Path& path) {
     int i = 0;
-    for (const std::unique_ptr<Curve>& pCurve : path) {
+    for (const AnyCurve& pCurve : path) {
         const Curve& curve = *pCurve;
 
         QPen colour;
@@ -168,7 +168,7 @@ void Demo::drawPath(const Path& path) {
         }
 
         if (curve.type() == LineSegment::type) {
-            const LineSegment& lseg = dynamic_cast<const LineSegment&>(curve);
+            const LineSegment& lseg = static_cast<const LineSegment&>(curve);
 
             QPainterPath pp;
             pp.moveTo(lseg.A().x, lseg.A().y);
@@ -177,7 +177,7 @@ void Demo::drawPath(const Path& path) {
             m_scene->addPath(pp, colour);
         }
         else if (curve.type() == CubicBezier::type) {
-            const CubicBezier& bezier = dynamic_cast<const CubicBezier&>(curve);
+            const CubicBezier& bezier = static_cast<const CubicBezier&>(curve);
 
             QPainterPath pp;
             pp.moveTo(bezier.A().x, bezier.A().y);
@@ -0,0 +1,143 @@
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+
+#include <cstddef>
+#include <list>
+#include <new>
+#include <vector>
+
+
+namespace csmerge {
+
+
+// A monotonic buffer. Allocations are carved sequentially out of large
+// blocks and are never freed individually; release() frees everything at
+// once. One block of the standard size is kept across releases, so an arena
+// that is reused for one merge after another stops touching malloc once it
+// has warmed up. An allocation too big for a standard block gets a block of
+// its own, which the next release frees. When an allocation doesn't fit in
+// what is left of the current block, that remainder goes unused until the
+// next release.
+//
+class Arena {
+    public:
+        explicit Arena(size_t blockSize = 64 * 1024);
+
+        void* allocate(size_t size, size_t align);
+        void release();
+
+        // Total bytes handed out since the last release
+        size_t bytesAllocated() const;
+
+        // Total size of the blocks currently held
+        size_t bytesReserved() const;
+
+        ~Arena();
+
+    private:
+        Arena(const Arena&);
+        Arena& operator=(const Arena&);
+
+        struct Block {
+            Block* next;
+            size_t size;
+        };
+
+        Block* newBlock(size_t size);
+
+        size_t m_blockSize;
+        Block* m_blocks;
+        char* m_cur;
+        char* m_end;
+        size_t m_bytesAllocated;
+        size_t m_bytesReserved;
+};
+
+
+// The arena that ArenaAllocators constructed on this thread will use, or
+// null if no ArenaScope is active.
+Arena* currentArena();
+
+
+// Makes an arena current on this thread for the lifetime of the scope, and
+// releases it when the scope ends. The default constructor uses a
+// thread-local arena and does nothing if an arena is already current, so
+// scopes can be nested freely. A disabled scope does nothing at all.
+//
+class ArenaScope {
+    public:
+        explicit ArenaScope(bool enabled = true);
+        explicit ArenaScope(Arena& arena);
+
+        ~ArenaScope();
+
+    private:
+        ArenaScope(const ArenaScope&);
+        ArenaScope& operator=(const ArenaScope&);
+
+        Arena* m_arena;
+        Arena* m_prev;
+};
+
+
+// Standard allocator that draws from the arena current at its construction,
+// or from the global heap if there is none. Containers using it must not
+// outlive the enclosing ArenaScope.
+//
+template <class T>
+class ArenaAllocator {
+    public:
+        typedef T value_type;
+
+        ArenaAllocator()
+            : m_arena(currentArena()) {}
+
+        template <class U>
+        ArenaAllocator(const ArenaAllocator<U>& cpy)
+            : m_arena(cpy.arena()) {}
+
+        T* allocate(size_t n) {
+            if (m_arena != nullptr) {
+                return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+            }
+
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t) {
+            if (m_arena == nullptr) {
+                ::operator delete(p);
+            }
+        }
+
+        Arena* arena() const {
+            return m_arena;
+        }
+
+    private:
+        Arena* m_arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() != rhs.arena();
+}
+
+
+template <class T>
+using ArenaList = std::list<T, ArenaAllocator<T>>;
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+
+}
+
+
+#endif
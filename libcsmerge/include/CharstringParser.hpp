@@ -0,0 +1,520 @@
+#ifndef __CHARSTRING_PARSER_HPP__
+#define __CHARSTRING_PARSER_HPP__
+
+
+#include <cstdint>
+#include <string>
+#include "Charstrings.hpp"
+#include "Geometry.hpp"
+
+
+namespace csmerge {
+
+
+// A push-style charstring interpreter. Drawing operators are reported to the
+// Sink as they are decoded, in absolute coordinates. A Sink must provide:
+//
+//     void moveTo(const geometry::Point& P);
+//     void lineTo(const geometry::Point& B);
+//     void curveTo(const geometry::Point& B, const geometry::Point& C, const geometry::Point& D);
+//     void closePath();
+//
+// Segments start where the previous event left off. closePath() is called
+// when a moveto or endchar ends a contour that has at least one segment.
+// moveTo() may be called several times in a row.
+//
+template <class Sink>
+class CharstringParser {
+    public:
+        // The Type 2 argument stack limit
+        static const int MAX_ARGS = 48;
+
+        explicit CharstringParser(Sink& sink)
+            : m_sink(sink), m_open(false), m_nargs(0), m_numStems(0) {}
+
+        void push(double num) {
+            if (m_nargs == MAX_ARGS) {
+                throw ParseError("Argument stack overflow");
+            }
+
+            m_args[m_nargs++] = num;
+        }
+
+        // Every operator we handle clears the argument stack. If the handler
+        // throws, the arguments are left for the error message.
+        void execute(CsOperator_t op) {
+            OpHandler handler = op < CS_OP_NUM_TYPE2 ? HANDLERS[op] : nullptr;
+
+            if (handler == nullptr) {
+                throw UnrecognisedToken(op);
+            }
+
+            handler(*this, m_args, m_nargs);
+            m_nargs = 0;
+        }
+
+        const double* args() const {
+            return m_args;
+        }
+
+        int numArgs() const {
+            return m_nargs;
+        }
+
+        int numStems() const {
+            return m_numStems;
+        }
+
+    private:
+        typedef void (*OpHandler)(CharstringParser& p, const double* args, int nargs);
+
+        static const OpHandler HANDLERS[CS_OP_NUM_TYPE2];
+
+        void moveTo(const geometry::Point& P) {
+            if (m_open) {
+                m_sink.closePath();
+                m_open = false;
+            }
+
+            m_cursor = P;
+            m_sink.moveTo(P);
+        }
+
+        void lineTo(const geometry::Point& B) {
+            m_sink.lineTo(B);
+
+            m_cursor = B;
+            m_open = true;
+        }
+
+        // Appends a curve given relative to the cursor, as in rrcurveto
+        void rcurveTo(double bx, double by, double cx, double cy, double dx, double dy) {
+            geometry::Point B = m_cursor + geometry::Point(bx, by);
+            geometry::Point C = B + geometry::Point(cx, cy);
+            geometry::Point D = C + geometry::Point(dx, dy);
+
+            m_sink.curveTo(B, C, D);
+
+            m_cursor = D;
+            m_open = true;
+        }
+
+        void closePath() {
+            if (m_open) {
+                m_sink.closePath();
+                m_open = false;
+            }
+        }
+
+        static void op_rmoveto(CharstringParser& p, const double* args, int nargs) {
+            if (nargs != 2) {
+                throw WrongNumberOfArguments("rmoveto", nargs);
+            }
+
+            p.moveTo(p.m_cursor + geometry::Point(args[0], args[1]));
+        }
+
+        static void op_hmoveto(CharstringParser& p, const double* args, int nargs) {
+            if (nargs != 1) {
+                throw WrongNumberOfArguments("hmoveto", nargs);
+            }
+
+            p.moveTo(p.m_cursor + geometry::Point(args[0], 0));
+        }
+
+        static void op_vmoveto(CharstringParser& p, const double* args, int nargs) {
+            if (nargs != 1) {
+                throw WrongNumberOfArguments("vmoveto", nargs);
+            }
+
+            p.moveTo(p.m_cursor + geometry::Point(0, args[0]));
+        }
+
+        static void op_rlineto(CharstringParser& p, const double* args, int nargs) {
+            if (nargs % 2 != 0) {
+                throw WrongNumberOfArguments("rlineto", nargs);
+            }
+
+            for (int i = 0; i < nargs; i += 2) {
+                p.lineTo(p.m_cursor + geometry::Point(args[i], args[i + 1]));
+            }
+        }
+
+        // Alternating horizontal and vertical lines, starting horizontal if
+        // horizontalFirst is true
+        static void alternatingLines(CharstringParser& p, const double* args, int nargs,
+            bool horizontalFirst) {
+
+            for (int i = 0; i < nargs; ++i) {
+                if ((i % 2 == 0) == horizontalFirst) {
+                    p.lineTo(p.m_cursor + geometry::Point(args[i], 0));
+                }
+                else {
+                    p.lineTo(p.m_cursor + geometry::Point(0, args[i]));
+                }
+            }
+        }
+
+        static void op_hlineto(CharstringParser& p, const double* args, int nargs) {
+            alternatingLines(p, args, nargs, true);
+        }
+
+        static void op_vlineto(CharstringParser& p, const double* args, int nargs) {
+            alternatingLines(p, args, nargs, false);
+        }
+
+        static void op_rrcurveto(CharstringParser& p, const double* args, int nargs) {
+            if (nargs % 6 != 0) {
+                throw WrongNumberOfArguments("rrcurveto", nargs);
+            }
+
+            for (int i = 0; i < nargs; i += 6) {
+                p.rcurveTo(args[i], args[i + 1], args[i + 2], args[i + 3], args[i + 4], args[i + 5]);
+            }
+        }
+
+        static void op_hhcurveto(CharstringParser& p, const double* args, int nargs) {
+            if (nargs % 4 != 0 && nargs % 4 != 1) {
+                throw WrongNumberOfArguments("hhcurveto", nargs);
+            }
+
+            int i = 0;
+            double by = 0;
+
+            if (nargs % 4 == 1) {
+                by = args[i];
+                ++i;
+            }
+
+            for (; i < nargs; i += 4) {
+                p.rcurveTo(args[i], by, args[i + 1], args[i + 2], args[i + 3], 0);
+                by = 0;
+            }
+        }
+
+        static void op_vvcurveto(CharstringParser& p, const double* args, int nargs) {
+            if (nargs % 4 != 0 && nargs % 4 != 1) {
+                throw WrongNumberOfArguments("vvcurveto", nargs);
+            }
+
+            int i = 0;
+            double bx = 0;
+
+            if (nargs % 4 == 1) {
+                bx = args[i];
+                ++i;
+            }
+
+            for (; i < nargs; i += 4) {
+                p.rcurveTo(bx, args[i], args[i + 1], args[i + 2], 0, args[i + 3]);
+                bx = 0;
+            }
+        }
+
+        // Curves whose tangents alternate between horizontal and vertical, as in
+        // hvcurveto and vhcurveto. The final curve may take an extra argument
+        // giving the otherwise-zero component of its last control vector.
+        static void alternatingCurves(CharstringParser& p, const double* args, int nargs,
+            bool horizontalFirst, const char* name) {
+
+            if (nargs < 4 || (nargs % 4 != 0 && nargs % 4 != 1)) {
+                throw WrongNumberOfArguments(name, nargs);
+            }
+
+            bool horizontal = horizontalFirst;
+            int n = nargs / 4;
+
+            for (int cv = 0; cv < n; ++cv) {
+                const double* a = args + cv * 4;
+                double extra = (cv == n - 1 && nargs % 4 == 1) ? a[4] : 0;
+
+                if (horizontal) {
+                    p.rcurveTo(a[0], 0, a[1], a[2], extra, a[3]);
+                }
+                else {
+                    p.rcurveTo(0, a[0], a[1], a[2], a[3], extra);
+                }
+
+                horizontal = !horizontal;
+            }
+        }
+
+        static void op_hvcurveto(CharstringParser& p, const double* args, int nargs) {
+            alternatingCurves(p, args, nargs, true, "hvcurveto");
+        }
+
+        static void op_vhcurveto(CharstringParser& p, const double* args, int nargs) {
+            alternatingCurves(p, args, nargs, false, "vhcurveto");
+        }
+
+        static void op_rcurveline(CharstringParser& p, const double* args, int nargs) {
+            if (nargs < 8 || nargs % 6 != 2) {
+                throw WrongNumberOfArguments("rcurveline", nargs);
+            }
+
+            op_rrcurveto(p, args, nargs - 2);
+            op_rlineto(p, args + nargs - 2, 2);
+        }
+
+        static void op_rlinecurve(CharstringParser& p, const double* args, int nargs) {
+            if (nargs < 8 || nargs % 2 != 0) {
+                throw WrongNumberOfArguments("rlinecurve", nargs);
+            }
+
+            op_rlineto(p, args, nargs - 6);
+            op_rrcurveto(p, args + nargs - 6, 6);
+        }
+
+        static void op_endchar(CharstringParser& p, const double*, int nargs) {
+            if (nargs != 0) {
+                throw WrongNumberOfArguments("endchar", nargs);
+            }
+
+            p.closePath();
+        }
+
+        // Stem hints are irrelevant after a union, so they are discarded. We
+        // must still count them to know the length of any hintmask/cntrmask data.
+        static void op_stems(CharstringParser& p, const double*, int nargs) {
+            if (nargs % 2 != 0) {
+                throw WrongNumberOfArguments("stem hint", nargs);
+            }
+
+            p.m_numStems += nargs / 2;
+        }
+
+        static void op_flex(CharstringParser&, const double*, int) {
+            throw NotImplementedException("Token 'flex' is not implemented.");
+        }
+
+        static void op_hflex(CharstringParser&, const double*, int) {
+            throw NotImplementedException("Token 'hflex' is not implemented.");
+        }
+
+        static void op_hflex1(CharstringParser&, const double*, int) {
+            throw NotImplementedException("Token 'hflex1' is not implemented.");
+        }
+
+        static void op_flex1(CharstringParser&, const double*, int) {
+            throw NotImplementedException("Token 'flex1' is not implemented.");
+        }
+
+        Sink& m_sink;
+        geometry::Point m_cursor;
+        bool m_open;
+        double m_args[MAX_ARGS];
+        int m_nargs;
+        int m_numStems;
+};
+
+
+// Handlers indexed by CsOperator_t. Operators without a handler are
+// unrecognised. Any arguments left on the stack at hintmask/cntrmask are an
+// implicit vstem, hence op_stems.
+template <class Sink>
+const typename CharstringParser<Sink>::OpHandler CharstringParser<Sink>::HANDLERS[CS_OP_NUM_TYPE2] = {
+    nullptr,        op_stems,       nullptr,        op_stems,       // -, hstem, -, vstem
+    op_vmoveto,     op_rlineto,     op_hlineto,     op_vlineto,
+    op_rrcurveto,   nullptr,        nullptr,        nullptr,        // rrcurveto, -, callsubr, return
+    nullptr,        nullptr,        op_endchar,     nullptr,        // escape, -, endchar, -
+    nullptr,        nullptr,        op_stems,       op_stems,       // -, -, hstemhm, hintmask
+    op_stems,       op_rmoveto,     op_hmoveto,     op_stems,       // cntrmask, rmoveto, hmoveto, vstemhm
+    op_rcurveline,  op_rlinecurve,  op_vvcurveto,   op_hhcurveto,
+    nullptr,        nullptr,        op_vhcurveto,   op_hvcurveto,   // shortint, callgsubr, ...
+
+    // Escaped operators. Only the flex family are drawing operators.
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr, nullptr, op_hflex, op_flex, op_hflex1, op_flex1
+};
+
+
+// A Sink that finds the control box of an outline: the box around every
+// point of its segments, control points included, which therefore contains
+// the outline. A moveto with no segments after it adds nothing.
+class BoundingBoxSink {
+    public:
+        void moveTo(const geometry::Point& P) {
+            m_cursor = P;
+        }
+
+        void lineTo(const geometry::Point& B) {
+            m_box.extend(m_cursor);
+            m_box.extend(B);
+
+            m_cursor = B;
+        }
+
+        void curveTo(const geometry::Point& B, const geometry::Point& C, const geometry::Point& D) {
+            m_box.extend(m_cursor);
+            m_box.extend(B);
+            m_box.extend(C);
+            m_box.extend(D);
+
+            m_cursor = D;
+        }
+
+        void closePath() {}
+
+        const geometry::BoundingBox& bbox() const {
+            return m_box;
+        }
+
+    private:
+        geometry::Point m_cursor;
+        geometry::BoundingBox m_box;
+};
+
+
+namespace detail {
+
+
+static const uint8_t TYPE2_ESCAPE = 12;
+static const uint8_t TYPE2_SHORTINT = 28;
+static const uint8_t TYPE2_FIXED = 255;
+
+
+ParseError makeParseError(const std::string& msg, const std::string& tokName, int tokIdx,
+    const double* args, int nargs, const CsMergeException* pEx);
+
+inline uint8_t readByte(const uint8_t* data, size_t size, size_t& pos) {
+    if (pos >= size) {
+        throw ParseError("Unexpected end of charstring data");
+    }
+
+    return data[pos++];
+}
+
+// Reads a single operand starting with byte b0, which has already been
+// consumed.
+inline double readOperand(uint8_t b0, const uint8_t* data, size_t size, size_t& pos) {
+    if (b0 >= 32 && b0 <= 246) {
+        return static_cast<int>(b0) - 139;
+    }
+    else if (b0 >= 247 && b0 <= 250) {
+        int b1 = readByte(data, size, pos);
+        return (b0 - 247) * 256 + b1 + 108;
+    }
+    else if (b0 >= 251 && b0 <= 254) {
+        int b1 = readByte(data, size, pos);
+        return -(b0 - 251) * 256 - b1 - 108;
+    }
+    else if (b0 == TYPE2_SHORTINT) {
+        uint16_t hi = readByte(data, size, pos);
+        uint16_t lo = readByte(data, size, pos);
+
+        return static_cast<int16_t>((hi << 8) | lo);
+    }
+    else {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value = (value << 8) | readByte(data, size, pos);
+        }
+
+        return static_cast<int32_t>(value) / 65536.0;
+    }
+}
+
+
+}
+
+
+template <class Sink>
+void parseCharstring(const Charstring& charstring, Sink& sink) {
+    CharstringParser<Sink> parser(sink);
+
+    for (size_t i = 0; i < charstring.size(); ++i) {
+        const CsToken& tok = charstring[i];
+
+        try {
+            if (tok.type == PS_OPERAND) {
+                parser.push(tok.num);
+            }
+            else if (tok.type == PS_OPERATOR) {
+                parser.execute(tok.op);
+            }
+        }
+        catch (CsMergeException& ex) {
+            throw detail::makeParseError("", tok.str(), i, parser.args(), parser.numArgs(), &ex);
+        }
+    }
+
+    if (parser.numArgs() != 0) {
+        throw ParseError("Redundant arguments on stack");
+    }
+}
+
+template <class Sink>
+void parseCharstring(const uint8_t* data, size_t size, Sink& sink) {
+    CharstringParser<Sink> parser(sink);
+    int tokIdx = 0;
+
+    size_t pos = 0;
+    while (pos < size) {
+        uint8_t b0 = data[pos++];
+
+        if (b0 >= 32 || b0 == detail::TYPE2_SHORTINT) {
+            try {
+                parser.push(detail::readOperand(b0, data, size, pos));
+            }
+            catch (CsMergeException& ex) {
+                throw detail::makeParseError("", "<operand>", tokIdx, parser.args(),
+                    parser.numArgs(), &ex);
+            }
+
+            ++tokIdx;
+            continue;
+        }
+
+        CsOperator_t op = static_cast<CsOperator_t>(b0);
+
+        if (b0 == detail::TYPE2_ESCAPE) {
+            if (pos >= size) {
+                throw detail::makeParseError("Unexpected end of charstring data", "<escape>", tokIdx,
+                    parser.args(), parser.numArgs(), nullptr);
+            }
+
+            op = static_cast<CsOperator_t>(CS_OP_ESCAPED + data[pos++]);
+        }
+
+        if (op >= CS_OP_NUM_TYPE2 || operatorName(op).empty()) {
+            throw detail::makeParseError("Reserved operator", "<reserved>", tokIdx, parser.args(),
+                parser.numArgs(), nullptr);
+        }
+
+        try {
+            parser.execute(op);
+
+            if (op == CS_OP_HINTMASK || op == CS_OP_CNTRMASK) {
+                pos += (parser.numStems() + 7) / 8;
+
+                if (pos > size) {
+                    throw ParseError("Unexpected end of charstring data");
+                }
+            }
+        }
+        catch (CsMergeException& ex) {
+            throw detail::makeParseError("", operatorName(op), tokIdx, parser.args(),
+                parser.numArgs(), &ex);
+        }
+
+        ++tokIdx;
+    }
+
+    if (parser.numArgs() != 0) {
+        throw ParseError("Redundant arguments on stack");
+    }
+}
+
+template <class Sink>
+void parseCharstring(const Type2Charstring& charstring, Sink& sink) {
+    parseCharstring(charstring.data(), charstring.size(), sink);
+}
+
+
+}
+
+
+#endif
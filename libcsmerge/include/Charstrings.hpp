@@ -2,6 +2,7 @@
 #define __CHARSTRINGS_H__
 
 
+#include <cstdint>
 #include <stdexcept>
 #include <vector>
 #include "Exception.hpp"
@@ -11,30 +12,106 @@
 namespace csmerge {
 
 
-enum CsTokenType_t {
+enum CsTokenType_t : uint8_t {
     PS_OPERATOR = 0,
     PS_OPERAND = 1
 };
 
 
+// Operator IDs. Type 2 operators are identified by their opcode, with two-byte
+// (escaped) operators at CS_OP_ESCAPED + their second byte. Any other operator
+// name is given an ID from CS_OP_INTERNED upwards by hashing it, and the
+// most recent names are remembered so that they can be reported in errors.
+enum CsOperator_t : uint16_t {
+    CS_OP_HSTEM = 1,
+    CS_OP_VSTEM = 3,
+    CS_OP_VMOVETO = 4,
+    CS_OP_RLINETO = 5,
+    CS_OP_HLINETO = 6,
+    CS_OP_VLINETO = 7,
+    CS_OP_RRCURVETO = 8,
+    CS_OP_CALLSUBR = 10,
+    CS_OP_RETURN = 11,
+    CS_OP_ENDCHAR = 14,
+    CS_OP_HSTEMHM = 18,
+    CS_OP_HINTMASK = 19,
+    CS_OP_CNTRMASK = 20,
+    CS_OP_RMOVETO = 21,
+    CS_OP_HMOVETO = 22,
+    CS_OP_VSTEMHM = 23,
+    CS_OP_RCURVELINE = 24,
+    CS_OP_RLINECURVE = 25,
+    CS_OP_VVCURVETO = 26,
+    CS_OP_HHCURVETO = 27,
+    CS_OP_CALLGSUBR = 29,
+    CS_OP_VHCURVETO = 30,
+    CS_OP_HVCURVETO = 31,
+
+    CS_OP_ESCAPED = 32,
+    CS_OP_AND = CS_OP_ESCAPED + 3,
+    CS_OP_OR = CS_OP_ESCAPED + 4,
+    CS_OP_NOT = CS_OP_ESCAPED + 5,
+    CS_OP_ABS = CS_OP_ESCAPED + 9,
+    CS_OP_ADD = CS_OP_ESCAPED + 10,
+    CS_OP_SUB = CS_OP_ESCAPED + 11,
+    CS_OP_DIV = CS_OP_ESCAPED + 12,
+    CS_OP_NEG = CS_OP_ESCAPED + 14,
+    CS_OP_EQ = CS_OP_ESCAPED + 15,
+    CS_OP_DROP = CS_OP_ESCAPED + 18,
+    CS_OP_PUT = CS_OP_ESCAPED + 20,
+    CS_OP_GET = CS_OP_ESCAPED + 21,
+    CS_OP_IFELSE = CS_OP_ESCAPED + 22,
+    CS_OP_RANDOM = CS_OP_ESCAPED + 23,
+    CS_OP_MUL = CS_OP_ESCAPED + 24,
+    CS_OP_SQRT = CS_OP_ESCAPED + 26,
+    CS_OP_DUP = CS_OP_ESCAPED + 27,
+    CS_OP_EXCH = CS_OP_ESCAPED + 28,
+    CS_OP_INDEX = CS_OP_ESCAPED + 29,
+    CS_OP_ROLL = CS_OP_ESCAPED + 30,
+    CS_OP_HFLEX = CS_OP_ESCAPED + 34,
+    CS_OP_FLEX = CS_OP_ESCAPED + 35,
+    CS_OP_HFLEX1 = CS_OP_ESCAPED + 36,
+    CS_OP_FLEX1 = CS_OP_ESCAPED + 37,
+
+    CS_OP_NUM_TYPE2 = CS_OP_ESCAPED + 38,
+    CS_OP_INTERNED = 256
+};
+
+
+// A 16 byte tagged value. Operator tokens carry only their ID; the string
+// constructors are kept for convenience and look the ID up by name.
 struct CsToken {
     CsToken(double num);
     CsToken(int num);
+    CsToken(CsOperator_t op);
     CsToken(const char* str);
     CsToken(const std::string& str);
-    CsToken(const CsToken& cpy);
 
     bool operator==(const CsToken& rhs) const;
     bool operator!=(const CsToken& rhs) const;
 
+    // The operator name, or an empty string for operands
+    std::string str() const;
+
     CsTokenType_t type;
+    CsOperator_t op;
     double num;
-    std::string str;
 };
 
 
 typedef std::vector<CsToken> Charstring;
 
+// Raw Type 2 charstring bytes, as stored in a CFF CharStrings INDEX. As with
+// the token form, the charstring should be desubroutinized and have the
+// leading set-width value removed.
+typedef std::vector<uint8_t> Type2Charstring;
+
+
+CsOperator_t operatorId(const char* name);
+
+// Empty for reserved opcodes. Names that aren't Type 2 operators are kept
+// for a while only, after which a placeholder is returned.
+std::string operatorName(CsOperator_t op);
 
 std::ostream& operator<<(std::ostream& out, const CsToken& tok);
 std::ostream& operator<<(std::ostream& out, const Charstring& cs);
@@ -82,9 +159,44 @@ class NotImplementedException : public ParseError {
 };
 
 
+class EncodeError : public CsMergeException {
+    using CsMergeException::CsMergeException;
+};
+
+
+// If set, each merge serves its temporary geometry allocations from a
+// thread-local arena, released in one step when the merge returns.
+extern bool USE_MERGE_ARENA;
+
+// If set, as by default, parsed outlines are normalised (see
+// geometry::normalise) before they go to the boolean engine. Repeated points
+// and straight cubics are then never seen by the engine, and a merge's output
+// has none either. Clear it to have the operands' segments passed on as
+// parsed.
+extern bool NORMALISE_OUTLINES;
+
+
 Charstring mergeCharstrings(const Charstring& cs1, const Charstring& cs2);
 geometry::PathList parseCharstring(const Charstring& charstring);
+geometry::PathList parseCharstring(const uint8_t* data, size_t size);
+geometry::PathList parseCharstring(const Type2Charstring& charstring);
 Charstring generateCharstring(const geometry::PathList& paths);
+Charstring generateCharstring(const geometry::Outline& outline);
+
+// The Type 2 variants append to the output buffer, so callers may reuse one
+// buffer across many glyphs.
+void mergeCharstrings(const Type2Charstring& cs1, const Type2Charstring& cs2, Type2Charstring& out);
+void generateCharstring(const geometry::PathList& paths, Type2Charstring& out);
+void generateCharstring(const geometry::Outline& outline, Type2Charstring& out);
+
+// Parse and convert a charstring once, e.g. a watermark, to merge into many
+// glyphs with the overloads below.
+geometry::PreparedOperand prepareCharstring(const Charstring& charstring);
+geometry::PreparedOperand prepareCharstring(const Type2Charstring& charstring);
+
+Charstring mergeCharstrings(const Charstring& cs, const geometry::PreparedOperand& prepared);
+void mergeCharstrings(const Type2Charstring& cs, const geometry::PreparedOperand& prepared,
+    Type2Charstring& out);
 
 
 }
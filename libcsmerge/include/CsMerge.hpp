@@ -2,8 +2,10 @@
 #define __CS_MERGE_HPP__
 
 
+#include "Arena.hpp"
 #include "Geometry.hpp"
 #include "Charstrings.hpp"
+#include "CharstringParser.hpp"
 
 
 namespace csmerge {
@@ -2,7 +2,10 @@
 #define __GEOMETRY_HPP__
 
 
+#include <cassert>
+#include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <CGAL/basic.h>
 #include <CGAL/Cartesian.h>
@@ -11,12 +14,10 @@
 #include <CGAL/Gps_traits_2.h>
 #include <CGAL/General_polygon_set_2.h>
 #include <CGAL/Polygon_2.h>
-#ifdef APPROX_BEZIERS
-#    include <CGAL/Exact_predicates_exact_constructions_kernel.h>
-#    include <CGAL/Polygon_2.h>
-#    include <CGAL/Polygon_with_holes_2.h>
-#    include <CGAL/Polygon_set_2.h>
-#endif
+#include <CGAL/Exact_predicates_exact_constructions_kernel.h>
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Polygon_with_holes_2.h>
+#include <CGAL/Polygon_set_2.h>
 #include "Exception.hpp"
 
 
@@ -90,6 +91,29 @@ struct Point {
 };
 
 
+// An axis-aligned box. A default constructed box is empty.
+struct BoundingBox {
+    BoundingBox();
+
+    void extend(const Point& P);
+    void extend(const BoundingBox& box);
+    bool empty() const;
+    bool contains(const BoundingBox& rhs) const;
+
+    // Boxes that touch, to within FLOAT_PRECISION, count as overlapping
+    bool overlaps(const BoundingBox& rhs) const;
+
+    double xmin;
+    double ymin;
+    double xmax;
+    double ymax;
+};
+
+
+// Curves form a closed set: every Curve is a LineSegment or a CubicBezier,
+// identified by its type() tag. Code that needs the concrete type should
+// switch on the tag (or use visitCurve) rather than dynamic_cast.
+//
 class Curve {
     public:
         Curve(size_t typeId);
@@ -112,7 +136,7 @@ class Curve {
 
 class LineSegment : public Curve {
     public:
-        static size_t type;
+        static constexpr size_t type = 0;
 
         LineSegment(const Point& A, const Point& B);
 
@@ -136,7 +160,7 @@ class LineSegment : public Curve {
 
 class CubicBezier : public Curve {
     public:
-        static size_t type;
+        static constexpr size_t type = 1;
 
         CubicBezier(const Point& A, const Point& B, const Point& C, const Point& D);
 
@@ -162,6 +186,39 @@ class CubicBezier : public Curve {
 };
 
 
+// Holds a LineSegment or CubicBezier by value. Dereferences to the contained
+// curve, so it can be used much like a pointer to Curve.
+//
+class AnyCurve {
+    public:
+        // Throws GeometryException if the curve is of neither type
+        explicit AnyCurve(const Curve& curve);
+        AnyCurve(const AnyCurve& cpy);
+
+        AnyCurve& operator=(const AnyCurve& rhs);
+
+        size_t type() const;
+
+        const Curve& operator*() const;
+        Curve& operator*();
+        const Curve* operator->() const;
+        Curve* operator->();
+
+        ~AnyCurve();
+
+    private:
+        void construct(const Curve& curve);
+        void destroy();
+
+        size_t m_type;
+
+        union {
+            LineSegment m_lseg;
+            CubicBezier m_bezier;
+        };
+};
+
+
 class Path;
 typedef std::vector<Path> PathList;
 
@@ -169,8 +226,8 @@ typedef std::vector<Path> PathList;
 //
 class Path {
     public:
-        typedef std::vector<std::unique_ptr<Curve>>::iterator iterator;
-        typedef std::vector<std::unique_ptr<Curve>>::const_iterator const_iterator;
+        typedef std::vector<AnyCurve>::iterator iterator;
+        typedef std::vector<AnyCurve>::const_iterator const_iterator;
 
         Path();
         Path(Path&& cpy);
@@ -200,22 +257,195 @@ class Path {
         ~Path();
 
     private:
-        std::vector<std::unique_ptr<Curve>> m_curves;
+        std::vector<AnyCurve> m_curves;
 };
 
 
+// A list of contours stored as flat arrays, with no per-segment allocation.
+//
+// Each contour is a sequence of verbs and the points they pass through. The
+// first point of a contour is its initial point; a line segment adds its end
+// point and a cubic bezier adds its two control points and end point.
+// Contours are index ranges into the shared arrays.
+//
+// An Outline is also a sink for CharstringParser.
+//
+class Outline {
+    public:
+        enum Verb : uint8_t {
+            LINE = 0,
+            CUBIC = 1
+        };
+
+        // A read-only view of one contour
+        struct Contour {
+            const Verb* verbs;
+            size_t numVerbs;
+            const Point* points;
+            size_t numPoints;
+
+            bool empty() const;
+            bool isClosed() const;
+            const Point& initialPoint() const;
+            const Point& finalPoint() const;
+
+            // The bounds of the control hull, which contains the contour
+            BoundingBox bbox() const;
+        };
+
+        // Starts a new contour at P. If the current contour has no segments,
+        // its initial point is moved instead.
+        void moveTo(const Point& P);
+
+        void lineTo(const Point& B);
+        void curveTo(const Point& B, const Point& C, const Point& D);
+
+        // Joins the last point of the current contour to the first with a
+        // line segment, if they differ
+        void closePath();
+
+        void append(const Outline& outline);
+        void append(const Contour& contour);
+        void reserve(size_t numVerbs, size_t numPoints);
+        void clear();
+
+        bool empty() const;
+        size_t numContours() const;
+        Contour contour(size_t idx) const;
+
+        const std::vector<Verb>& verbs() const;
+        const std::vector<Point>& points() const;
+
+    private:
+        void beginContour(const Point& P);
+
+        std::vector<Verb> m_verbs;
+        std::vector<Point> m_points;
+        std::vector<size_t> m_contourVerbs;   // Index of each contour's first verb
+        std::vector<size_t> m_contourPoints;  // Index of each contour's first point
+};
+
+
+Outline toOutline(const PathList& paths);
+PathList toPathList(const Outline& outline);
+
+
+std::ostream& operator<<(std::ostream& out, const BoundingBox& box);
 std::ostream& operator<<(std::ostream& out, const Curve& curve);
 std::ostream& operator<<(std::ostream& out, const Point& pt);
 std::ostream& operator<<(std::ostream& out, const Path& path);
+std::ostream& operator<<(std::ostream& out, const Outline& outline);
 
 
 extern double FLOAT_PRECISION;
 extern double MIN_LSEG_LENGTH;        // These are only used in the APPROX_BEZIERS build
 extern double MAX_LSEGS_PER_BEZIER;   //
+extern double FLATTENING_TOLERANCE;   //
+
+// If FLATTENING_TOLERANCE is positive, beziers are flattened adaptively so no
+// point strays further than that from the curve, and the two settings above
+// are ignored. This sets it as a fraction of the font's em square.
+void setRelativeFlatteningTolerance(double fraction, double unitsPerEm);
+
+// If positive, the lines of each union's input, once flattened, and of its
+// output are simplified to within these distances; see simplify
+extern double SIMPLIFY_INPUT_TOLERANCE;
+extern double SIMPLIFY_OUTPUT_TOLERANCE;
+
+// Vertices removed from union inputs and outputs by simplification on the
+// calling thread, since the thread started or the counts were last reset
+struct SimplifyStats {
+    size_t inputVerticesRemoved = 0;
+    size_t outputVerticesRemoved = 0;
+};
+
+SimplifyStats& simplifyStats();
+
+// If set, in the exact build, unions are computed where possible with the
+// exact polygon kernel, whose filtered predicates decide almost everything
+// in doubles, rather than the algebraic Bezier engine. Each curve is given
+// to it as its chord and put back on the result, which is only done if
+// every curve of the union is monotone and has nothing else reaching into
+// its control box; the chord then bounds the union wherever the curve
+// would. Any other union, such as one in which curves cross, goes to the
+// Bezier engine. The approx engine's settings don't apply. Off by default.
+extern bool USE_LINEAR_ENGINE;
+
+inline size_t Curve::type() const {
+    return m_type;
+}
+
+inline size_t AnyCurve::type() const {
+    return m_type;
+}
+
+inline const Curve& AnyCurve::operator*() const {
+    if (m_type == LineSegment::type) {
+        return m_lseg;
+    }
+
+    return m_bezier;
+}
+
+inline Curve& AnyCurve::operator*() {
+    if (m_type == LineSegment::type) {
+        return m_lseg;
+    }
+
+    return m_bezier;
+}
+
+inline const Curve* AnyCurve::operator->() const {
+    return &**this;
+}
+
+inline Curve* AnyCurve::operator->() {
+    return &**this;
+}
+
+// Calls f with the curve cast to its concrete type. The visitor must accept
+// both a const LineSegment& and a const CubicBezier&.
+template <class F>
+auto visitCurve(const Curve& curve, F&& f) -> decltype(f(std::declval<const LineSegment&>())) {
+    if (curve.type() == LineSegment::type) {
+        return f(static_cast<const LineSegment&>(curve));
+    }
+
+    assert(curve.type() == CubicBezier::type);
+    return f(static_cast<const CubicBezier&>(curve));
+}
+
 
 void initialise();
+Outline computeUnion(const Outline& outline1, const Outline& outline2);
 PathList computeUnion(const PathList& paths1, const PathList& paths2);
 
+// Union of any number of outlines, computed as a balanced tree of pairwise
+// unions
+Outline computeUnion(const std::vector<Outline>& outlines);
+
+// Removes vertices from the runs of line segments, by Douglas-Peucker, so
+// that each stays within the tolerance of what is left. Curves and their
+// ends are kept. Sets removed to the number of vertices removed.
+Outline simplify(const Outline& outline, double tolerance, size_t& removed);
+PathList simplify(const PathList& paths, double tolerance, size_t& removed);
+
+// Simplify a union's input or output to SIMPLIFY_INPUT_TOLERANCE or
+// SIMPLIFY_OUTPUT_TOLERANCE, counting the vertices removed in simplifyStats
+Outline simplifyInput(const Outline& outline);
+Outline simplifyOutput(const Outline& outline);
+
+// Removes segments of no length, so merging repeated points, and turns
+// cubics whose control points all lie along their chord into lines. Points
+// less than half a step of the 16.16 grid apart count as the same, whatever
+// FLOAT_PRECISION is. Contours left with nothing are dropped.
+Outline normalise(const Outline& outline);
+
+// Signed area enclosed by a closed contour, positive if it runs counter-
+// clockwise. It is found in closed form from the control points, in double
+// precision, taking the contour to close back to its start.
+double signedArea(const Outline::Contour& contour);
+
 
 class GeometryException : public CsMergeException {
     using CsMergeException::CsMergeException;
@@ -236,15 +466,23 @@ class NoncontiguousCurvesException : public GeometryException {
 
 // ----- Private functions, exposed here for testing only -----
 
+cgal_wrap::PolyList toPolyList(const Outline& outline);
 cgal_wrap::PolyList toPolyList(const PathList& paths);
+Outline toOutline(const cgal_wrap::PolyList& polyList);
 PathList toPathList(const cgal_wrap::PolyList& polyList);
 cgal_wrap::BezierCurve cubicBezierFromXMonoSection(const cgal_wrap::BezierXMonotoneCurve& mono);
-PathList computeUnion(const PathList& paths1, const PathList& paths2);
+
+// The same section's control points, subdivided in double precision; what
+// the conversion back to an Outline uses. Returns their number, 2 or 4.
+size_t controlPointsOfXMonoSection(const cgal_wrap::BezierXMonotoneCurve& mono, Point* out);
+
+// Evaluates the cubic at n + 1 evenly spaced parameter values into out
+void sampleCubic(const Point& A, const Point& B, const Point& C, const Point& D, int n, Point* out);
 
 
 // Namespace containing temporary solution due to bug in CGAL4.7. Bezier
-// polygons are approximated by regular polygons.
-#ifdef APPROX_BEZIERS
+// polygons are approximated by regular polygons. The polygon engine here is
+// built in both modes, as the exact build uses it for unions of lines only.
 namespace approx {
 
 
@@ -258,22 +496,120 @@ typedef CGAL::Polygon_with_holes_2<Kernel> PolygonWithHoles;
 typedef CGAL::Polygon_set_2<Kernel> PolygonSet;
 typedef std::vector<PolygonWithHoles> PolyList;
 
+// Robust predicates but double constructions; used when USE_FAST_KERNEL is set
+typedef CGAL::Exact_predicates_inexact_constructions_kernel FastKernel;
+typedef FastKernel::Point_2 FastPoint;
+typedef CGAL::Polygon_2<FastKernel> FastPolygon;
+typedef CGAL::Polygon_with_holes_2<FastKernel> FastPolygonWithHoles;
+typedef CGAL::Polygon_set_2<FastKernel> FastPolygonSet;
+typedef std::vector<FastPolygonWithHoles> FastPolyList;
+
 
 }
 
 
+// If set, unions are first computed with the inexact-construction kernel,
+// and the result's vertices rounded to the charstring's fixed-point grid.
+// This is not snap rounding: rounding may still make edges cross, so the
+// result is checked and, failing that, recomputed with the exact kernel.
+// CGAL documents Polygon_set_2 as requiring exact constructions, so this is
+// an unsupported use; a failure it reports as an exception falls back, but
+// one that corrupts or aborts the process does not. Off by default.
+extern bool USE_FAST_KERNEL;
+
+// Joins the polygons with the fast kernel. Returns false, leaving result
+// untouched, if the engine threw, the rounded area strayed from the
+// unrounded one, or the rounded polygons are not a valid union: edges
+// crossing or overlapping, a hole outside its outer boundary or overlapping
+// another hole, or one polygon lying on or inside another's filled region.
+bool fastJoin(const cgal_approx::PolyList& polyList1, const cgal_approx::PolyList& polyList2,
+    Outline& result);
+
+// If set, unions bypass CGAL altogether and use the native clipper below on
+// the flattened outlines, building CGAL polygons only to fall back on if it
+// fails. Takes precedence over USE_FAST_KERNEL.
+extern bool USE_NATIVE_CLIPPER;
+
+// Union of two flattened outlines, each filled by the nonzero rule, computed
+// in double precision. Returns false, leaving result untouched, if rounding
+// error left the boundary inconsistent.
+bool nativeUnion(const Outline& linear1, const Outline& linear2, Outline& result);
+PathList nativeUnion(const PathList& linear1, const PathList& linear2);
+
+// Joins the polygons with CGAL, using the fast kernel if USE_FAST_KERNEL is
+// set. The native clipper is never used here, as it takes outlines.
+Outline joinPolyLists(const cgal_approx::PolyList& polyList1, const cgal_approx::PolyList& polyList2);
+
+// If set, stretches of a union's boundary that follow one of the flattened
+// input curves are given back as that curve, or the part of it they span,
+// rather than as the line segments approximating it. Vertices snapped by
+// the fast kernel no longer match their curves, so they stay linear.
+extern bool RESTORE_CURVES;
+
+// Replaces each run of consecutive samples of one of the source's cubics, in
+// the flattened outline, with the part of the cubic between its ends
+Outline restoreCurves(const Outline& linear, const Outline& source);
+
+// If greater than zero, cubics are fitted to the lines left in a union's
+// output, to within this distance; see fitCurves
+extern double CURVE_FIT_TOLERANCE;
+
+// Replaces the runs of line segments between corners with as few cubics as
+// fit them to within the tolerance. Existing cubics are kept as they are.
+Outline fitCurves(const Outline& outline, double tolerance);
+PathList fitCurves(const PathList& paths, double tolerance);
+
+cgal_approx::PolyList toPolyList(const Outline& outline);
 cgal_approx::PolyList toPolyList(const PathList& paths);
+Outline toOutline(const cgal_approx::PolyList& polyList);
 PathList toPathList(const cgal_approx::PolyList& polyList);
+Outline toLinearOutline(const Outline& outline);
 PathList toLinearPaths(const PathList& paths);
+Outline computeUnion(const Outline& outline1, const Outline& outline2);
 PathList computeUnion(const PathList& paths1, const PathList& paths2);
 
 
 }
-#endif
 
 // ------------------------------------------------------------
 
 
+// An outline converted once into the boolean engine's input form, so it can
+// be merged into many others without repeating that work: flattened
+// polygons in the APPROX_BEZIERS build, x-monotone curves otherwise.
+//
+// Merges only read a PreparedOperand. Sharing one between threads relies on
+// CGAL's reference counting being thread-safe (CGAL_HAS_THREADS).
+//
+class PreparedOperand {
+    public:
+#ifdef APPROX_BEZIERS
+        typedef approx::cgal_approx::Polygon Polygon;
+#else
+        typedef cgal_wrap::BezierPolygon Polygon;
+#endif
+
+        // Throws GeometryException if a contour is not closed
+        explicit PreparedOperand(const Outline& outline);
+
+        const Outline& outline() const;
+        const BoundingBox& bbox() const;
+
+        // One entry per contour; empty contours have empty entries
+        const std::vector<BoundingBox>& contourBoxes() const;
+        const std::vector<Polygon>& polygons() const;
+
+    private:
+        Outline m_outline;
+        BoundingBox m_bbox;
+        std::vector<BoundingBox> m_contourBoxes;
+        std::vector<Polygon> m_polygons;
+};
+
+
+Outline computeUnion(const Outline& outline, const PreparedOperand& prepared);
+
+
 }
 }
 
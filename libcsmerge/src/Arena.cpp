@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <cstdlib>
+#include "Arena.hpp"
+
+
+namespace csmerge {
+
+
+static thread_local Arena* g_currentArena = nullptr;
+
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize), m_blocks(nullptr), m_cur(nullptr), m_end(nullptr), m_bytesAllocated(0),
+      m_bytesReserved(0) {}
+
+static char* alignUp(char* p, size_t align) {
+    uintptr_t u = (reinterpret_cast<uintptr_t>(p) + align - 1) & ~(uintptr_t(align) - 1);
+    return reinterpret_cast<char*>(u);
+}
+
+Arena::Block* Arena::newBlock(size_t size) {
+    Block* block = static_cast<Block*>(malloc(size));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    block->next = nullptr;
+    block->size = size;
+    m_bytesReserved += size;
+
+    return block;
+}
+
+void* Arena::allocate(size_t size, size_t align) {
+    char* p = alignUp(m_cur, align);
+
+    if (m_cur == nullptr || p + size > m_end) {
+        size_t needed = sizeof(Block) + size + align;
+
+        if (needed > m_blockSize) {
+            // Too big for a block of the standard size, so it gets a block of
+            // its own, linked behind the current one, whose free tail stays
+            // in use
+            Block* block = newBlock(needed);
+
+            if (m_blocks != nullptr) {
+                block->next = m_blocks->next;
+                m_blocks->next = block;
+            }
+            else {
+                m_blocks = block;
+            }
+
+            m_bytesAllocated += size;
+            return alignUp(reinterpret_cast<char*>(block + 1), align);
+        }
+
+        // Otherwise the current block's free tail is abandoned until the
+        // next release; it is smaller than this allocation
+        Block* block = newBlock(m_blockSize);
+        block->next = m_blocks;
+        m_blocks = block;
+
+        m_cur = reinterpret_cast<char*>(block + 1);
+        m_end = reinterpret_cast<char*>(block) + block->size;
+        p = alignUp(m_cur, align);
+    }
+
+    m_cur = p + size;
+    m_bytesAllocated += size;
+
+    return p;
+}
+
+void Arena::release() {
+    // Keep one block of the standard size for the next merge. Blocks made for
+    // oversized allocations are freed, so one large merge doesn't hold on to
+    // its memory for the life of the thread.
+    Block* kept = nullptr;
+
+    while (m_blocks != nullptr) {
+        Block* next = m_blocks->next;
+
+        if (kept == nullptr && m_blocks->size == m_blockSize) {
+            kept = m_blocks;
+            kept->next = nullptr;
+        }
+        else {
+            m_bytesReserved -= m_blocks->size;
+            free(m_blocks);
+        }
+
+        m_blocks = next;
+    }
+
+    m_blocks = kept;
+    m_cur = kept != nullptr ? reinterpret_cast<char*>(kept + 1) : nullptr;
+    m_end = kept != nullptr ? reinterpret_cast<char*>(kept) + kept->size : nullptr;
+    m_bytesAllocated = 0;
+}
+
+size_t Arena::bytesAllocated() const {
+    return m_bytesAllocated;
+}
+
+size_t Arena::bytesReserved() const {
+    return m_bytesReserved;
+}
+
+Arena::~Arena() {
+    while (m_blocks != nullptr) {
+        Block* next = m_blocks->next;
+        free(m_blocks);
+        m_blocks = next;
+    }
+}
+
+
+Arena* currentArena() {
+    return g_currentArena;
+}
+
+
+static Arena& threadArena() {
+    static thread_local Arena arena;
+    return arena;
+}
+
+
+ArenaScope::ArenaScope(bool enabled)
+    : m_arena(nullptr), m_prev(g_currentArena) {
+
+    if (enabled && g_currentArena == nullptr) {
+        m_arena = &threadArena();
+        g_currentArena = m_arena;
+    }
+}
+
+ArenaScope::ArenaScope(Arena& arena)
+    : m_arena(&arena), m_prev(g_currentArena) {
+
+    g_currentArena = m_arena;
+}
+
+ArenaScope::~ArenaScope() {
+    if (m_arena != nullptr) {
+        g_currentArena = m_prev;
+        m_arena->release();
+    }
+}
+
+
+}
@@ -1,10 +1,14 @@
 #include <cassert>
-#include <deque>
-#include <list>
-#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 #include <sstream>
+#include "Arena.hpp"
 #include "Geometry.hpp"
 #include "Charstrings.hpp"
+#include "CharstringParser.hpp"
 #include "Util.hpp"
 
 
@@ -17,24 +21,126 @@ namespace csmerge {
 using namespace geometry;
 
 
-typedef std::deque<CsToken> Stack;
-typedef std::vector<CsToken> TokenList;
+static_assert(sizeof(CsToken) <= 16, "CsToken should be a compact tagged value");
+
+
+// Operator names indexed by CsOperator_t. Null entries are reserved opcodes.
+static const char* const OPERATOR_NAMES[CS_OP_NUM_TYPE2] = {
+    nullptr, "hstem", nullptr, "vstem", "vmoveto", "rlineto", "hlineto", "vlineto",
+    "rrcurveto", nullptr, "callsubr", "return", nullptr, nullptr, "endchar", nullptr,
+    nullptr, nullptr, "hstemhm", "hintmask", "cntrmask", "rmoveto", "hmoveto", "vstemhm",
+    "rcurveline", "rlinecurve", "vvcurveto", "hhcurveto", nullptr, "callgsubr", "vhcurveto",
+    "hvcurveto",
+
+    // Escaped operators
+    nullptr, nullptr, nullptr, "and", "or", "not", nullptr, nullptr,
+    nullptr, "abs", "add", "sub", "div", nullptr, "neg", "eq",
+    nullptr, nullptr, "drop", nullptr, "put", "get", "ifelse", "random",
+    "mul", nullptr, "sqrt", "dup", "exch", "index", "roll", nullptr,
+    nullptr, nullptr, "hflex", "flex", "hflex1", "flex1"
+};
+
+
+// Names that aren't Type 2 operators. Their ID is a hash of the name, so
+// making a token never fails and the ID doesn't depend on what other names
+// have been seen; two unknown names that collide compare equal, which is
+// harmless as both are rejected by the parser. The names themselves are only
+// needed for error messages, so they are kept in a fixed number of slots,
+// each holding the latest name to hash there, behind a lock. Once a name has
+// been displaced, its tokens report a placeholder.
+class InternedOperators {
+    public:
+        CsOperator_t intern(const char* name) {
+            size_t hash = std::hash<string>()(name);
+            CsOperator_t id = static_cast<CsOperator_t>(CS_OP_INTERNED + hash % NUM_IDS);
+
+            Slot& slot = m_slots[id % NUM_SLOTS];
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (slot.id != id || slot.name != name) {
+                slot.id = id;
+                slot.name.assign(name, strnlen(name, MAX_NAME_LENGTH));
+            }
+
+            return id;
+        }
+
+        // Returns a copy, as the slot may be reused by another thread
+        string name(CsOperator_t op) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            const Slot& slot = m_slots[op % NUM_SLOTS];
+            return slot.id == op ? slot.name : "<unrecognised operator>";
+        }
+
+    private:
+        static const size_t NUM_IDS = UINT16_MAX + 1 - CS_OP_INTERNED;
+        static const size_t NUM_SLOTS = 256;
+        static const size_t MAX_NAME_LENGTH = 64;
+
+        struct Slot {
+            CsOperator_t id = CsOperator_t(0);
+            string name;
+        };
+
+        std::mutex m_mutex;
+        Slot m_slots[NUM_SLOTS];
+};
+
+static InternedOperators& internedOperators() {
+    static InternedOperators interned;
+    return interned;
+}
+
+CsOperator_t operatorId(const char* name) {
+    static const std::unordered_map<string, CsOperator_t> type2Ids = [] {
+        std::unordered_map<string, CsOperator_t> ids;
+
+        for (int i = 0; i < CS_OP_NUM_TYPE2; ++i) {
+            if (OPERATOR_NAMES[i] != nullptr) {
+                ids[OPERATOR_NAMES[i]] = static_cast<CsOperator_t>(i);
+            }
+        }
+
+        return ids;
+    }();
+
+    auto i = type2Ids.find(name);
+    if (i != type2Ids.end()) {
+        return i->second;
+    }
+
+    return internedOperators().intern(name);
+}
+
+string operatorName(CsOperator_t op) {
+    if (op < CS_OP_NUM_TYPE2) {
+        return OPERATOR_NAMES[op] != nullptr ? OPERATOR_NAMES[op] : "";
+    }
+
+    return internedOperators().name(op);
+}
 
 
 CsToken::CsToken(double num)
-    : type(PS_OPERAND), num(num) {}
+    : type(PS_OPERAND), op(CsOperator_t(0)), num(num) {}
 
 CsToken::CsToken(int num)
-    : type(PS_OPERAND), num(num) {}
+    : type(PS_OPERAND), op(CsOperator_t(0)), num(num) {}
+
+CsToken::CsToken(CsOperator_t op)
+    : type(PS_OPERATOR), op(op), num(0) {}
 
 CsToken::CsToken(const char* str)
-    : type(PS_OPERATOR), str(str) {}
+    : type(PS_OPERATOR), op(operatorId(str)), num(0) {}
 
 CsToken::CsToken(const string& str)
-    : type(PS_OPERATOR), str(str) {}
+    : type(PS_OPERATOR), op(operatorId(str.c_str())), num(0) {}
 
-CsToken::CsToken(const CsToken& cpy)
-    : type(cpy.type), num(cpy.num), str(cpy.str) {}
+string CsToken::str() const {
+    return type == PS_OPERATOR ? operatorName(op) : string();
+}
 
 bool CsToken::operator==(const CsToken& rhs) const {
     if (type != rhs.type) {
@@ -42,7 +148,7 @@ bool CsToken::operator==(const CsToken& rhs) const {
     }
 
     switch (type) {
-        case PS_OPERATOR: return str == rhs.str;
+        case PS_OPERATOR: return op == rhs.op;
         case PS_OPERAND: return num == rhs.num;
         default: assert(false);
     }
@@ -56,7 +162,7 @@ bool CsToken::operator!=(const CsToken& rhs) const {
 
 std::ostream& operator<<(std::ostream& out, const CsToken& tok) {
     if (tok.type == PS_OPERATOR) {
-        out << tok.str;
+        out << tok.str();
     }
     else {
         out << tok.num;
@@ -89,7 +195,7 @@ const char* UnrecognisedToken::what() const noexcept {
 
     std::stringstream ss;
     ss << ParseError::what()
-       << "(Token: str='" << m_token.str << "', num=" << m_token.num << ")";
+       << "(Token: str='" << m_token.str() << "', num=" << m_token.num << ")";
 
     msg = ss.str();
 
@@ -133,8 +239,8 @@ int WrongNumberOfArguments::getNumArgs() const noexcept {
 }
 
 
-static ParseError makeParseError(const string& msg, const string& tokName, int tokIdx,
-    const Stack& stack, const CsMergeException* pEx) {
+ParseError detail::makeParseError(const string& msg, const string& tokName, int tokIdx,
+    const double* args, int nargs, const CsMergeException* pEx) {
 
     std::stringstream ss;
 
@@ -146,15 +252,10 @@ static ParseError makeParseError(const string& msg, const string& tokName, int t
     }
 
     ss << "(Token index: " << tokIdx << ", Token name: '" << tokName << "', Stack: [";
-    for (unsigned int i = 0; i < stack.size(); ++i) {
-        if (stack[i].type == PS_OPERATOR) {
-            ss << stack[i].str;
-        }
-        else {
-            ss << stack[i].num;
-        }
+    for (int i = 0; i < nargs; ++i) {
+        ss << args[i];
 
-        if (i + 1 < stack.size()) {
+        if (i + 1 < nargs) {
             ss << ", ";
         }
     }
@@ -168,736 +269,337 @@ static ParseError makeParseError(const string& msg, const string& tokName, int t
     return ParseError(ss.str());
 }
 
-static ParseError makeParseError(const string& msg, const string& tokName, int tokIdx,
-    const Stack& stack, const CsMergeException& ex) {
 
-    return makeParseError(msg, tokName, tokIdx, stack, &ex);
-}
-
-static ParseError makeParseError(const string& tokName, int tokIdx, const Stack& stack,
-    const CsMergeException& ex) {
+static void unparseLineSegment(Charstring& cs, const Point& cursor, const Point& B) {
+    Point P = B - cursor;
 
-    return makeParseError("", tokName, tokIdx, stack, ex);
+    cs.push_back(P.x);
+    cs.push_back(P.y);
+    cs.push_back(CS_OP_RLINETO);
 }
 
-static ParseError makeParseError(const string& msg, const string& tokName, int tokIdx,
-    const Stack& stack) {
-
-    return makeParseError(msg, tokName, tokIdx, stack, nullptr);
+static void unparseCubicBezier(Charstring& cs, const Point& cursor, const Point* ctrl) {
+    Point B = ctrl[0] - cursor;
+    Point C = ctrl[1] - ctrl[0];
+    Point D = ctrl[2] - ctrl[1];
+
+    cs.push_back(B.x);
+    cs.push_back(B.y);
+    cs.push_back(C.x);
+    cs.push_back(C.y);
+    cs.push_back(D.x);
+    cs.push_back(D.y);
+    cs.push_back(CS_OP_RRCURVETO);
 }
 
-static ParseError makeParseError(const string& tokName, int tokIdx, const Stack& stack) {
-    return makeParseError("", tokName, tokIdx, stack, nullptr);
-}
+PathList parseCharstring(const Charstring& charstring) {
+    Outline outline;
+    parseCharstring(charstring, outline);
 
-static ParseError makeParseError(const string& msg) {
-    return ParseError(msg);
+    return toPathList(outline);
 }
 
+PathList parseCharstring(const uint8_t* data, size_t size) {
+    Outline outline;
+    parseCharstring(data, size, outline);
 
-static TokenList getArgs(Stack& stack) {
-    TokenList vec;
-
-    for (int i = static_cast<int>(stack.size() - 1); i >= 0; --i) {
-        if (stack[i].type == PS_OPERAND) {
-            vec.push_back(stack[i]);
-            stack.pop_back();
-        }
-        else {
-            break;
-        }
-    }
-
-    std::reverse(vec.begin(), vec.end());
-    return vec;
+    return toPathList(outline);
 }
 
-static void process(PathList& paths, Point& cursor, Stack& stack, const CsToken op) {
-    assert(op.type == PS_OPERATOR);
-
-    TokenList args = getArgs(stack);
-    int nargs = args.size();
-
-    if (paths.size() == 0) {
-        paths.push_back(Path());
-    }
-
-    Path* path = &paths.back();
-
-    if (op.str == "rmoveto") {
-        if (nargs != 2) {
-            throw WrongNumberOfArguments("rmoveto", nargs);
-        }
-
-        double x = args[0].num;
-        double y = args[1].num;
-
-        if (!path->empty()) {
-            DBG_OUT("Starting new empty path\n");
-
-            path->close();
-            paths.push_back(Path());
-            path = &paths.back();
-        }
-
-        DBG_OUT("Moving cursor from " << cursor << " to " << cursor + Point(x, y) << "\n");
-        cursor += Point(x, y);
-    }
-    else if (op.str == "hmoveto") {
-        if (nargs != 1) {
-            throw WrongNumberOfArguments("hmoveto", nargs);
-        }
+PathList parseCharstring(const Type2Charstring& charstring) {
+    return parseCharstring(charstring.data(), charstring.size());
+}
 
-        double x = args[0].num;
+Charstring generateCharstring(const Outline& outline) {
+    Charstring cs;
+    Point cursor(0, 0);
 
-        if (!path->empty()) {
-            DBG_OUT("Starting new empty path\n");
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        Outline::Contour contour = outline.contour(i);
 
-            path->close();
-            paths.push_back(Path());
-            path = &paths.back();
+        if (contour.empty()) {
+            continue;
         }
 
-        DBG_OUT("Moving cursor from " << cursor << " to " << cursor + Point(x, 0) << "\n");
-        cursor += Point(x, 0);
-    }
-    else if (op.str == "vmoveto") {
-        if (nargs != 1) {
-            throw WrongNumberOfArguments("vmoveto", nargs);
-        }
+        const Point* A = contour.points;
 
-        double y = args[0].num;
+        if (A[0] != cursor) {
+            Point p_ = A[0] - cursor;
 
-        if (!path->empty()) {
-            DBG_OUT("Starting new empty path\n");
+            cs.push_back(p_.x);
+            cs.push_back(p_.y);
+            cs.push_back(CS_OP_RMOVETO);
 
-            path->close();
-            paths.push_back(Path());
-            path = &paths.back();
+            cursor = A[0];
         }
 
-        DBG_OUT("Moving cursor from " << cursor << " to " << cursor + Point(0, y) << "\n");
-        cursor += Point(0, y);
-    }
-    else if (op.str == "rlineto") {
-        if (nargs % 2 != 0) {
-            throw WrongNumberOfArguments("rlineto", nargs);
-        }
-
-        for (int i = 0; i < nargs; i += 2) {
-            double x = args[i].num;
-            double y = args[i + 1].num;
-
-            const Point& A = cursor;
-            Point B = cursor + Point(x, y);
-
-            LineSegment lseg(A, B);
-
-            DBG_OUT("Appending line segment: " << lseg << "\n");
-            path->append(lseg);
-
-            DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-            cursor = path->finalPoint();
-        }
-    }
-    else if (op.str == "hlineto") {
-        for (int i = 0; i < nargs; ++i) {
-            const Point& A = cursor;
-
-            if (i % 2 == 0) {
-                double x = args[i].num;
-                Point B = cursor + Point(x, 0);
-
-                LineSegment lseg(A, B);
-
-                DBG_OUT("Appending line segment: " << lseg << "\n");
-                path->append(lseg);
-
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
+        for (size_t j = 0; j < contour.numVerbs; ++j) {
+            if (contour.verbs[j] == Outline::LINE) {
+                unparseLineSegment(cs, cursor, A[1]);
+                A += 1;
             }
             else {
-                double y = args[i].num;
-                Point B = cursor + Point(0, y);
-
-                LineSegment lseg(A, B);
-
-                DBG_OUT("Appending line segment: " << lseg << "\n");
-                path->append(lseg);
-
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
+                unparseCubicBezier(cs, cursor, A + 1);
+                A += 3;
             }
+
+            cursor = A[0];
         }
     }
-    else if (op.str == "vlineto") {
-        for (int i = 0; i < nargs; ++i) {
-            const Point& A = cursor;
 
-            if (i % 2 == 0) {
-                double y = args[i].num;
-                Point B = cursor + Point(0, y);
-
-                LineSegment lseg(A, B);
+    cs.push_back(CS_OP_ENDCHAR);
+    return cs;
+}
 
-                DBG_OUT("Appending line segment: " << lseg << "\n");
-                path->append(lseg);
+Charstring generateCharstring(const PathList& paths) {
+    return generateCharstring(toOutline(paths));
+}
 
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
+// Writes Type 2 operands and operators into a byte buffer.
+//
+// Coordinates are quantised to 16.16 fixed point and the cursor is tracked in
+// that space, so relative moves never accumulate rounding drift. Consecutive
+// segments of the same kind share one operator, up to the Type 2 stack limit.
+class Type2Writer {
+    public:
+        explicit Type2Writer(Type2Charstring& out)
+            : m_out(out), m_x(0), m_y(0), m_pendingOp(CsOperator_t(0)), m_nargs(0) {}
+
+        void moveTo(const Point& p) {
+            flush();
+
+            int64_t dx = toFixed(p.x) - m_x;
+            int64_t dy = toFixed(p.y) - m_y;
+
+            if (dx == 0 && dy != 0) {
+                writeOperand(dy);
+                m_out.push_back(CS_OP_VMOVETO);
+            }
+            else if (dy == 0) {
+                writeOperand(dx);
+                m_out.push_back(CS_OP_HMOVETO);
             }
             else {
-                double x = args[i].num;
-                Point B = cursor + Point(x, 0);
-
-                LineSegment lseg(A, B);
-
-                DBG_OUT("Appending line segment: " << lseg << "\n");
-                path->append(lseg);
-
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
+                writeOperand(dx);
+                writeOperand(dy);
+                m_out.push_back(CS_OP_RMOVETO);
             }
-        }
-    }
-    else if (op.str == "rrcurveto") {
-        if (nargs % 6 != 0) {
-            throw WrongNumberOfArguments("rrcurveto", nargs);
-        }
 
-        for (int i = 0; i < nargs; i += 6) {
-            double bx = args[i].num;
-            double by = args[i + 1].num;
-            double cx = args[i + 2].num;
-            double cy = args[i + 3].num;
-            double dx = args[i + 4].num;
-            double dy = args[i + 5].num;
-
-            const Point& A = cursor;
-            Point B = A + Point(bx, by);
-            Point C = B + Point(cx, cy);
-            Point D = C + Point(dx, dy);
-
-            CubicBezier bezier(A, B, C, D);
-
-            DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-            path->append(bezier);
-
-            DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-            cursor = path->finalPoint();
+            m_x += dx;
+            m_y += dy;
         }
-    }
-    else if (op.str == "hhcurveto") {
-        if (nargs % 4 != 0 && nargs % 4 != 1) {
-            throw WrongNumberOfArguments("hhcurveto", nargs);
-        }
-
-        int i = 0;
-        double by = 0;
 
-        if (nargs % 4 == 1) {
-            by = args[i].num;
-            ++i;
+        void lineTo(const Point& p) {
+            begin(CS_OP_RLINETO, 2);
+            writeDelta(p);
         }
 
-        for (; i < nargs; i += 4) {
-            double bx = args[i].num;
-            double cx = args[i + 1].num;
-            double cy = args[i + 2].num;
-            double dx = args[i + 3].num;
-
-            const Point& A = cursor;
-            Point B = A + Point(bx, by);
-            Point C = B + Point(cx, cy);
-            Point D = C + Point(dx, 0);
-
-            CubicBezier bezier(A, B, C, D);
-
-            DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-            path->append(bezier);
-
-            DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-            cursor = path->finalPoint();
-
-            by = 0;
+        void curveTo(const Point& B, const Point& C, const Point& D) {
+            begin(CS_OP_RRCURVETO, 6);
+            writeDelta(B);
+            writeDelta(C);
+            writeDelta(D);
         }
-    }
-    else if (op.str == "hvcurveto") {
-        if (nargs % 8 == 4 || nargs % 8 == 5) {
-            double bx = args[0].num;
-            double cx = args[1].num;
-            double cy = args[2].num;
-            double dx = 0;
-            double dy = args[3].num;
-
-            if (nargs == 5) {
-                dx = args[4].num;
-            }
-
-            const Point& A = cursor;
-            Point B = A + Point(bx, 0);
-            Point C = B + Point(cx, cy);
-            Point D = C + Point(dx, dy);
-
-            CubicBezier bezier(A, B, C, D);
-
-            DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-            path->append(bezier);
-
-            DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-            cursor = path->finalPoint();
-
-            // Number of curves remaining
-            int n = (nargs - 4) / 8;
-
-            for (int cv = 0; cv < n; ++cv) {
-                int i = 4 + cv * 8;
-
-                double by = args[i].num;
-                double cx = args[i + 1].num;
-                double cy = args[i + 2].num;
-                double dx = args[i + 3].num;
 
-                const Point& A = cursor;
-                Point B = A + Point(0, by);
-                Point C = B + Point(cx, cy);
-                Point D = C + Point(dx, 0);
-
-                CubicBezier bezier(A, B, C, D);
-
-                DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                path->append(bezier);
-
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
-
-                {
-                    double bx = args[i + 4].num;
-                    double cx = args[i + 5].num;
-                    double cy = args[i + 6].num;
-                    double dx = 0;
-                    double dy = args[i + 7].num;
-
-                    if (cv == n - 1 && nargs % 8 == 5) {
-                        dx = args[i + 8].num;
-                    }
-
-                    const Point& A = cursor;
-                    Point B = A + Point(bx, 0);
-                    Point C = B + Point(cx, cy);
-                    Point D = C + Point(dx, dy);
-
-                    CubicBezier bezier(A, B, C, D);
-
-                    DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                    path->append(bezier);
-
-                    DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                    cursor = path->finalPoint();
-                }
-            }
+        void endChar() {
+            flush();
+            m_out.push_back(CS_OP_ENDCHAR);
         }
-        else if ((nargs >= 8 && nargs % 8 == 0) || nargs % 8 == 1) {
-            int n = nargs / 8;
-
-            for (int cv = 0; cv < n; ++cv) {
-                int i = cv * 8;
-
-                double bx = args[i].num;
-                double cx = args[i + 1].num;
-                double cy = args[i + 2].num;
-                double dy = args[i + 3].num;
-
-                const Point& A = cursor;
-                Point B = A + Point(bx, 0);
-                Point C = B + Point(cx, cy);
-                Point D = C + Point(0, dy);
-
-                CubicBezier bezier(A, B, C, D);
 
-                DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                path->append(bezier);
+    private:
+        static const int MAX_ARGS = 48;
 
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
-
-                {
-                    double by = args[i + 4].num;
-                    double cx = args[i + 5].num;
-                    double cy = args[i + 6].num;
-                    double dx = args[i + 7].num;
-                    double dy = 0;
-
-                    if (cv == n - 1 && nargs % 8 == 1) {
-                        dy = args[i + 8].num;
-                    }
-
-                    const Point& A = cursor;
-                    Point B = A + Point(0, by);
-                    Point C = B + Point(cx, cy);
-                    Point D = C + Point(dx, dy);
-
-                    CubicBezier bezier(A, B, C, D);
-
-                    DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                    path->append(bezier);
-
-                    DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                    cursor = path->finalPoint();
-                }
-            }
-        }
-        else {
-            throw WrongNumberOfArguments("hhcurveto", nargs);
-        }
-    }
-    else if (op.str == "rcurveline") {
-        if (nargs < 8 && nargs % 6 != 2) {
-            throw WrongNumberOfArguments("rcurveline", nargs);
+        static int64_t toFixed(double value) {
+            return llround(value * 65536.0);
         }
 
-        int n = (nargs - 2) / 6;
-
-        for (int cv = 0; cv < n; ++cv) {
-            int i = cv * 6;
-
-            for (int j = 0; j < 6; ++j) {
-                stack.push_back(args[i + j].num);
+        void begin(CsOperator_t op, int nargs) {
+            if (m_pendingOp != op || m_nargs + nargs > MAX_ARGS) {
+                flush();
+                m_pendingOp = op;
             }
 
-            process(paths, cursor, stack, "rrcurveto");
+            m_nargs += nargs;
         }
 
-        stack.push_back(args[nargs - 2]);
-        stack.push_back(args[nargs - 1]);
+        void flush() {
+            if (m_pendingOp != 0) {
+                m_out.push_back(m_pendingOp);
+            }
 
-        process(paths, cursor, stack, "rlineto");
-    }
-    else if (op.str == "rlinecurve") {
-        if (nargs < 8 && nargs % 2 != 0) {
-            throw WrongNumberOfArguments("rlinecurve", nargs);
+            m_pendingOp = CsOperator_t(0);
+            m_nargs = 0;
         }
 
-        int n = (nargs - 6) / 2;
-
-        for (int cv = 0; cv < n; ++cv) {
-            int i = cv * 2;
+        void writeDelta(const Point& p) {
+            int64_t x = toFixed(p.x);
+            int64_t y = toFixed(p.y);
 
-            stack.push_back(args[i].num);
-            stack.push_back(args[i + 1].num);
+            writeOperand(x - m_x);
+            writeOperand(y - m_y);
 
-            process(paths, cursor, stack, "rlineto");
+            m_x = x;
+            m_y = y;
         }
 
-        stack.push_back(args[nargs - 6]);
-        stack.push_back(args[nargs - 5]);
-        stack.push_back(args[nargs - 4]);
-        stack.push_back(args[nargs - 3]);
-        stack.push_back(args[nargs - 2]);
-        stack.push_back(args[nargs - 1]);
-
-        process(paths, cursor, stack, "rrcurveto");
-    }
-    else if (op.str == "vhcurveto") {
-        if (nargs % 8 == 4 || nargs % 8 == 5) {
-            double by = args[0].num;
-            double cx = args[1].num;
-            double cy = args[2].num;
-            double dx = args[3].num;
-            double dy = 0;
-
-            if (nargs == 5) {
-                dy = args[4].num;
-            }
-
-            const Point& A = cursor;
-            Point B = A + Point(0, by);
-            Point C = B + Point(cx, cy);
-            Point D = C + Point(dx, dy);
-
-            CubicBezier bezier(A, B, C, D);
-
-            DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-            path->append(bezier);
-
-            DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-            cursor = path->finalPoint();
-
-            // Number of curves remaining
-            int n = (nargs - 4) / 8;
-
-            for (int cv = 0; cv < n; ++cv) {
-                int i = 4 + cv * 8;
-
-                double bx = args[i].num;
-                double cx = args[i + 1].num;
-                double cy = args[i + 2].num;
-                double dy = args[i + 3].num;
-
-                const Point& A = cursor;
-                Point B = A + Point(bx, 0);
-                Point C = B + Point(cx, cy);
-                Point D = C + Point(0, dy);
-
-                CubicBezier bezier(A, B, C, D);
+        // Uses the shortest encoding that represents the value exactly.
+        void writeOperand(int64_t fixed) {
+            if (fixed % 65536 == 0) {
+                int64_t v = fixed / 65536;
 
-                DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                path->append(bezier);
-
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
-
-                {
-                    double by = args[i + 4].num;
-                    double cx = args[i + 5].num;
-                    double cy = args[i + 6].num;
-                    double dy = 0;
-                    double dx = args[i + 7].num;
-
-                    if (cv == n - 1 && nargs % 8 == 5) {
-                        dy = args[i + 8].num;
-                    }
-
-                    const Point& A = cursor;
-                    Point B = A + Point(0, by);
-                    Point C = B + Point(cx, cy);
-                    Point D = C + Point(dx, dy);
-
-                    CubicBezier bezier(A, B, C, D);
-
-                    DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                    path->append(bezier);
-
-                    DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                    cursor = path->finalPoint();
+                if (v >= -107 && v <= 107) {
+                    m_out.push_back(static_cast<uint8_t>(v + 139));
+                    return;
+                }
+                else if (v >= 108 && v <= 1131) {
+                    v -= 108;
+                    m_out.push_back(static_cast<uint8_t>(247 + v / 256));
+                    m_out.push_back(static_cast<uint8_t>(v % 256));
+                    return;
+                }
+                else if (v >= -1131 && v <= -108) {
+                    v = -v - 108;
+                    m_out.push_back(static_cast<uint8_t>(251 + v / 256));
+                    m_out.push_back(static_cast<uint8_t>(v % 256));
+                    return;
+                }
+                else if (v >= -32768 && v <= 32767) {
+                    uint16_t u = static_cast<uint16_t>(v);
+                    m_out.push_back(detail::TYPE2_SHORTINT);
+                    m_out.push_back(static_cast<uint8_t>(u >> 8));
+                    m_out.push_back(static_cast<uint8_t>(u & 0xff));
+                    return;
                 }
             }
-        }
-        else if ((nargs >= 8 && nargs % 8 == 0) || nargs % 8 == 1) {
-            int n = nargs / 8;
-
-            for (int cv = 0; cv < n; ++cv) {
-                int i = cv * 8;
-
-                double by = args[i].num;
-                double cx = args[i + 1].num;
-                double cy = args[i + 2].num;
-                double dx = args[i + 3].num;
-
-                const Point& A = cursor;
-                Point B = A + Point(0, by);
-                Point C = B + Point(cx, cy);
-                Point D = C + Point(dx, 0);
 
-                CubicBezier bezier(A, B, C, D);
-
-                DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                path->append(bezier);
+            if (fixed < INT32_MIN || fixed > INT32_MAX) {
+                std::stringstream ss;
+                ss << "Value out of range for Type 2 charstring: " << fixed / 65536.0;
+                throw EncodeError(ss.str());
+            }
 
-                DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                cursor = path->finalPoint();
+            uint32_t u = static_cast<uint32_t>(static_cast<int32_t>(fixed));
+            m_out.push_back(detail::TYPE2_FIXED);
+            m_out.push_back(static_cast<uint8_t>(u >> 24));
+            m_out.push_back(static_cast<uint8_t>((u >> 16) & 0xff));
+            m_out.push_back(static_cast<uint8_t>((u >> 8) & 0xff));
+            m_out.push_back(static_cast<uint8_t>(u & 0xff));
+        }
 
-                {
-                    double bx = args[i + 4].num;
-                    double cx = args[i + 5].num;
-                    double cy = args[i + 6].num;
-                    double dx = 0;
-                    double dy = args[i + 7].num;
+        Type2Charstring& m_out;
+        int64_t m_x;
+        int64_t m_y;
+        CsOperator_t m_pendingOp;
+        int m_nargs;
+};
 
-                    if (cv == n - 1 && nargs % 8 == 1) {
-                        dx = args[i + 8].num;
-                    }
+void generateCharstring(const Outline& outline, Type2Charstring& out) {
+    Type2Writer writer(out);
 
-                    const Point& A = cursor;
-                    Point B = A + Point(bx, 0);
-                    Point C = B + Point(cx, cy);
-                    Point D = C + Point(dx, dy);
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        Outline::Contour contour = outline.contour(i);
 
-                    CubicBezier bezier(A, B, C, D);
+        if (contour.empty()) {
+            continue;
+        }
 
-                    DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-                    path->append(bezier);
+        const Point* A = contour.points;
+        writer.moveTo(A[0]);
 
-                    DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-                    cursor = path->finalPoint();
+        for (size_t j = 0; j < contour.numVerbs; ++j) {
+            if (contour.verbs[j] == Outline::LINE) {
+                // The closing line segment is implicit in Type 2
+                if (j + 1 == contour.numVerbs && contour.isClosed()) {
+                    break;
                 }
+
+                writer.lineTo(A[1]);
+                A += 1;
+            }
+            else {
+                writer.curveTo(A[1], A[2], A[3]);
+                A += 3;
             }
-        }
-        else {
-            throw WrongNumberOfArguments("vhcurveto", nargs);
         }
     }
-    else if (op.str == "vvcurveto") {
-        if (nargs % 4 != 0 && nargs % 4 != 1) {
-            throw WrongNumberOfArguments("vvcurveto", nargs);
-        }
-
-        double bx = 0;
-        if (nargs % 4 == 1) {
-            bx = args[0].num;
-        }
-
-        int n = nargs / 4;
-
-        for (int cv = 0; cv < n; ++cv) {
-            int i = cv * 4;
-
-            if (nargs % 4 == 1) {
-                ++i;
-            }
-
-            double by = args[i].num;
-            double cx = args[i + 1].num;
-            double cy = args[i + 2].num;
-            double dy = args[i + 3].num;
 
-            const Point& A = cursor;
-            Point B = A + Point(bx, by);
-            Point C = B + Point(cx, cy);
-            Point D = C + Point(0, dy);
+    writer.endChar();
+}
 
-            CubicBezier bezier(A, B, C, D);
+void generateCharstring(const PathList& paths, Type2Charstring& out) {
+    generateCharstring(toOutline(paths), out);
+}
 
-            DBG_OUT("Appending cubic bezier: " << bezier << "\n");
-            path->append(bezier);
+bool USE_MERGE_ARENA = true;
+bool NORMALISE_OUTLINES = true;
 
-            DBG_OUT("Moving cursor from " << cursor << " to " << path->finalPoint() << "\n");
-            cursor = path->finalPoint();
 
-            bx = 0;
-        }
-    }
-    else if (op.str == "flex") {
-        throw NotImplementedException("Token 'flex' is not implemented.");
-    }
-    else if (op.str == "hflex") {
-        throw NotImplementedException("Token 'hflex' is not implemented.");
-    }
-    else if (op.str == "hflex1") {
-        throw NotImplementedException("Token 'hflex1' is not implemented.");
-    }
-    else if (op.str == "flex1") {
-        throw NotImplementedException("Token 'flex1' is not implemented.");
-    }
-    else if (op.str == "endchar") {
-        if (nargs != 0) {
-            throw WrongNumberOfArguments("endchar", nargs);
-        }
+// Parses a charstring into an outline ready for the boolean engine
+template <class C>
+static void parseOperand(const C& charstring, Outline& outline) {
+    parseCharstring(charstring, outline);
 
-        path->close();
-    }
-    else {
-        throw UnrecognisedToken(op);
+    if (NORMALISE_OUTLINES) {
+        outline = normalise(outline);
     }
 }
 
-static void unparseLineSegment(Charstring& cs, const Point& cursor, const LineSegment& lseg) {
-    assert(lseg.initialPoint() == cursor);
-
-    Point P = lseg.B() - cursor;
 
-    Charstring extra({
-        static_cast<double>(P.x),
-        static_cast<double>(P.y),
-        "rlineto"
-    });
-
-    cs.insert(cs.end(), extra.begin(), extra.end());
-}
-
-static void unparseCubicBezier(Charstring& cs, const Point& cursor, const CubicBezier& bezier) {
-    assert(bezier.initialPoint() == cursor);
+Charstring mergeCharstrings(const Charstring& cs1, const Charstring& cs2) {
+    ArenaScope scope(USE_MERGE_ARENA);
 
-    Point B = bezier.B() - cursor;
-    Point C = bezier.C() - bezier.B();
-    Point D = bezier.D() - bezier.C();
+    Outline outline1;
+    Outline outline2;
 
-    Charstring extra({
-        static_cast<double>(B.x), static_cast<double>(B.y),
-        static_cast<double>(C.x), static_cast<double>(C.y),
-        static_cast<double>(D.x), static_cast<double>(D.y),
-        "rrcurveto"
-    });
+    parseOperand(cs1, outline1);
+    parseOperand(cs2, outline2);
 
-    cs.insert(cs.end(), extra.begin(), extra.end());
+    return generateCharstring(computeUnion(outline1, outline2));
 }
 
-PathList parseCharstring(const Charstring& charstring) {
-    PathList paths;
-    Point cursor(0, 0);
-    Stack stack;
-
-    for (size_t i = 0; i < charstring.size(); ++i) {
-        const CsToken& tok = charstring[i];
+void mergeCharstrings(const Type2Charstring& cs1, const Type2Charstring& cs2, Type2Charstring& out) {
+    ArenaScope scope(USE_MERGE_ARENA);
 
-        try {
-            if (tok.type == PS_OPERAND) {
-                stack.push_back(tok);
-            }
-            else if (tok.type == PS_OPERATOR) {
-                process(paths, cursor, stack, tok);
-            }
-        }
-        catch (CsMergeException& ex) {
-            throw makeParseError(tok.str, i, stack, ex);
-        }
-    }
+    Outline outline1;
+    Outline outline2;
 
-    if (!stack.empty()) {
-        throw makeParseError("Redundant arguments on stack");
-    }
+    parseOperand(cs1, outline1);
+    parseOperand(cs2, outline2);
 
-    return paths;
+    generateCharstring(computeUnion(outline1, outline2), out);
 }
 
-Charstring generateCharstring(const PathList& paths) {
-    Charstring cs;
-    Point cursor(0, 0);
-
-    for (auto i = paths.begin(); i != paths.end(); ++i) {
-        const Path& path = *i;
-
-        for (auto j = path.begin(); j != path.end(); ++j) {
-            const Curve& curve = **j;
-            Point p = curve.initialPoint();
 
-            if (p != cursor) {
-                Point p_ = p - cursor;
+PreparedOperand prepareCharstring(const Charstring& charstring) {
+    Outline outline;
+    parseOperand(charstring, outline);
 
-                Charstring extra({
-                    static_cast<double>(p_.x),
-                    static_cast<double>(p_.y),
-                    "rmoveto"
-                });
+    return PreparedOperand(outline);
+}
 
-                cs.insert(cs.end(), extra.begin(), extra.end());
+PreparedOperand prepareCharstring(const Type2Charstring& charstring) {
+    Outline outline;
+    parseOperand(charstring, outline);
 
-                cursor = p;
-            }
+    return PreparedOperand(outline);
+}
 
-            if (curve.type() == LineSegment::type) {
-                const LineSegment& lseg = dynamic_cast<const LineSegment&>(curve);
-                unparseLineSegment(cs, cursor, lseg);
-            }
-            else if (curve.type() == CubicBezier::type) {
-                const CubicBezier& bezier = dynamic_cast<const CubicBezier&>(curve);
-                unparseCubicBezier(cs, cursor, bezier);
-            }
+Charstring mergeCharstrings(const Charstring& cs, const PreparedOperand& prepared) {
+    ArenaScope scope(USE_MERGE_ARENA);
 
-            cursor = curve.finalPoint();
-        }
-    }
+    Outline outline;
+    parseOperand(cs, outline);
 
-    cs.push_back("endchar");
-    return cs;
+    return generateCharstring(computeUnion(outline, prepared));
 }
 
-Charstring mergeCharstrings(const Charstring& cs1, const Charstring& cs2) {
-    PathList paths1 = parseCharstring(cs1);
-    PathList paths2 = parseCharstring(cs2);
-    PathList paths3 = computeUnion(paths1, paths2);
+void mergeCharstrings(const Type2Charstring& cs, const PreparedOperand& prepared, Type2Charstring& out) {
+    ArenaScope scope(USE_MERGE_ARENA);
+
+    Outline outline;
+    parseOperand(cs, outline);
 
-    return generateCharstring(paths3);
+    generateCharstring(computeUnion(outline, prepared), out);
 }
 
 
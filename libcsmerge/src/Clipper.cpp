@@ -0,0 +1,641 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Arena.hpp"
+#include "Geometry.hpp"
+
+
+// A union engine for flattened outlines that works directly on doubles,
+// without building an arrangement:
+//
+//    1. Every edge is split wherever it meets another edge.
+//    2. Coincident pieces are merged, keeping the net number of times each
+//       operand's boundary runs along them in each direction.
+//    3. Each operand's winding number either side of each piece is found by
+//       casting a ray from its midpoint. A point is filled if it has nonzero
+//       winding in either operand, and pieces with filled space on exactly
+//       one side are the union's boundary.
+//    4. The boundary pieces, directed with the filled side on their left, are
+//       stitched back into contours.
+//
+// Points are compared exactly throughout; the Point class's own comparison
+// operators are tolerant, so they aren't used here.
+
+
+namespace csmerge {
+namespace geometry {
+namespace approx {
+
+
+bool USE_NATIVE_CLIPPER = false;
+
+// Vertices this close together are merged
+static const double SNAP_DISTANCE = 1e-9;
+
+// Vertices this close to the line through their neighbours are removed
+static const double COLLINEAR_DISTANCE = 1e-9;
+
+
+static bool samePoint(const Point& A, const Point& B) {
+    return A.x == B.x && A.y == B.y;
+}
+
+static bool lessPoint(const Point& A, const Point& B) {
+    return A.x < B.x || (A.x == B.x && A.y < B.y);
+}
+
+static double cross(const Point& a, const Point& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+static double sqLength(const Point& a) {
+    return a.x * a.x + a.y * a.y;
+}
+
+
+struct Segment {
+    Point A;
+    Point B;
+    BoundingBox box;
+    int operand;
+};
+
+// A point at which a segment must be split, at parameter t along it
+struct Split {
+    size_t segment;
+    double t;
+    Point P;
+
+    bool operator<(const Split& rhs) const {
+        return segment < rhs.segment || (segment == rhs.segment && t < rhs.t);
+    }
+};
+
+// A piece of the boundary, from P to Q where P < Q. Multiplicity counts each
+// operand's original edges running P to Q, less those running Q to P.
+struct Edge {
+    Point P;
+    Point Q;
+    int multiplicity[2];
+
+    bool operator<(const Edge& rhs) const {
+        if (!samePoint(P, rhs.P)) {
+            return lessPoint(P, rhs.P);
+        }
+
+        return lessPoint(Q, rhs.Q);
+    }
+};
+
+
+static void appendSegments(ArenaVector<Segment>& segments, const Outline& linear, int operand) {
+    for (size_t i = 0; i < linear.numContours(); ++i) {
+        Outline::Contour contour = linear.contour(i);
+
+        for (size_t j = 0; j < contour.numVerbs; ++j) {
+            assert(contour.verbs[j] == Outline::LINE);
+
+            Segment s;
+            s.A = contour.points[j];
+            s.B = contour.points[j + 1];
+            s.operand = operand;
+
+            if (samePoint(s.A, s.B)) {
+                continue;
+            }
+
+            s.box.extend(s.A);
+            s.box.extend(s.B);
+
+            segments.push_back(s);
+        }
+    }
+}
+
+static void addSplit(ArenaVector<Split>& splits, size_t idx, const Segment& s, const Point& P) {
+    if (samePoint(P, s.A) || samePoint(P, s.B)) {
+        return;
+    }
+
+    Point d = s.B - s.A;
+    double t = fabs(d.x) >= fabs(d.y) ? (P.x - s.A.x) / d.x : (P.y - s.A.y) / d.y;
+
+    if (t > 0.0 && t < 1.0) {
+        splits.push_back(Split{idx, t, P});
+    }
+}
+
+static void intersect(ArenaVector<Split>& splits, const ArenaVector<Segment>& segments, size_t i, size_t j) {
+    const Segment& s1 = segments[i];
+    const Segment& s2 = segments[j];
+
+    Point d1 = s1.B - s1.A;
+    Point d2 = s2.B - s2.A;
+    Point e = s2.A - s1.A;
+
+    double denom = cross(d1, d2);
+
+    if (denom == 0.0) {
+        if (cross(e, d1) != 0.0) {
+            return;
+        }
+
+        // Collinear, so each is split where the other ends
+        addSplit(splits, i, s1, s2.A);
+        addSplit(splits, i, s1, s2.B);
+        addSplit(splits, j, s2, s1.A);
+        addSplit(splits, j, s2, s1.B);
+
+        return;
+    }
+
+    double t = cross(e, d2) / denom;
+    double u = cross(e, d1) / denom;
+
+    if (t < 0.0 || t > 1.0 || u < 0.0 || u > 1.0) {
+        return;
+    }
+
+    Point P(s1.A.x + t * d1.x, s1.A.y + t * d1.y);
+
+    // A horizontal or vertical segment must stay so once split, or the rays
+    // cast along it would cross its own pieces
+    if (d1.y == 0.0 || d2.y == 0.0) {
+        P.y = d1.y == 0.0 ? s1.A.y : s2.A.y;
+    }
+
+    if (d1.x == 0.0 || d2.x == 0.0) {
+        P.x = d1.x == 0.0 ? s1.A.x : s2.A.x;
+    }
+
+    addSplit(splits, i, s1, P);
+    addSplit(splits, j, s2, P);
+}
+
+static void findSplits(const ArenaVector<Segment>& segments, ArenaVector<Split>& splits) {
+    ArenaVector<size_t> order(segments.size());
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&segments](size_t a, size_t b) {
+        return segments[a].box.xmin < segments[b].box.xmin;
+    });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const BoundingBox& box = segments[order[i]].box;
+
+        for (size_t j = i + 1; j < order.size() && segments[order[j]].box.xmin <= box.xmax; ++j) {
+            const BoundingBox& other = segments[order[j]].box;
+
+            if (other.ymin <= box.ymax && box.ymin <= other.ymax) {
+                intersect(splits, segments, order[i], order[j]);
+            }
+        }
+    }
+}
+
+static size_t findRoot(ArenaVector<size_t>& parent, size_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+// Different pairs of segments can compute a shared vertex slightly
+// differently, for instance where one segment crosses two that overlap, yet
+// the pieces either side of it must meet. So split points closer together
+// than SNAP_DISTANCE are moved onto one of them, preferring the segments'
+// own endpoints.
+static void mergeSplitPoints(const ArenaVector<Segment>& segments, ArenaVector<Split>& splits) {
+    size_t numEndpoints = 2 * segments.size();
+
+    auto point = [&](size_t k) -> const Point& {
+        if (k < numEndpoints) {
+            return k % 2 == 0 ? segments[k / 2].A : segments[k / 2].B;
+        }
+
+        return splits[k - numEndpoints].P;
+    };
+
+    ArenaVector<size_t> order(numEndpoints + splits.size());
+    ArenaVector<size_t> parent(order.size());
+
+    for (size_t k = 0; k < order.size(); ++k) {
+        order[k] = k;
+        parent[k] = k;
+    }
+
+    std::sort(order.begin(), order.end(), [&point](size_t a, size_t b) {
+        return point(a).x < point(b).x;
+    });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Point& P = point(order[i]);
+
+        for (size_t j = i + 1; j < order.size() && point(order[j]).x - P.x <= SNAP_DISTANCE; ++j) {
+            if (fabs(point(order[j]).y - P.y) > SNAP_DISTANCE) {
+                continue;
+            }
+
+            size_t a = findRoot(parent, order[i]);
+            size_t b = findRoot(parent, order[j]);
+
+            // The lower index, so endpoints take precedence, is the root
+            if (a < b) {
+                parent[b] = a;
+            }
+            else {
+                parent[a] = b;
+            }
+        }
+    }
+
+    // A root is never moved, so points can be read while others are updated
+    for (size_t k = numEndpoints; k < order.size(); ++k) {
+        splits[k - numEndpoints].P = point(findRoot(parent, k));
+    }
+}
+
+static void addEdge(ArenaVector<Edge>& edges, const Point& A, const Point& B, int operand) {
+    if (samePoint(A, B)) {
+        return;
+    }
+
+    Edge edge = lessPoint(A, B) ? Edge{A, B, {0, 0}} : Edge{B, A, {0, 0}};
+    edge.multiplicity[operand] = lessPoint(A, B) ? 1 : -1;
+
+    edges.push_back(edge);
+}
+
+// Splits the segments into edges, merging any that coincide
+static void buildEdges(const ArenaVector<Segment>& segments, const ArenaVector<Split>& splits,
+    ArenaVector<Edge>& edges) {
+
+    auto split = splits.begin();
+
+    for (size_t i = 0; i < segments.size(); ++i) {
+        Point A = segments[i].A;
+        int operand = segments[i].operand;
+
+        for (; split != splits.end() && split->segment == i; ++split) {
+            addEdge(edges, A, split->P, operand);
+            A = split->P;
+        }
+
+        addEdge(edges, A, segments[i].B, operand);
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    size_t n = 0;
+
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (n > 0 && samePoint(edges[n - 1].P, edges[i].P) && samePoint(edges[n - 1].Q, edges[i].Q)) {
+            edges[n - 1].multiplicity[0] += edges[i].multiplicity[0];
+            edges[n - 1].multiplicity[1] += edges[i].multiplicity[1];
+        }
+        else {
+            edges[n++] = edges[i];
+        }
+    }
+
+    edges.resize(n);
+
+    edges.erase(std::remove_if(edges.begin(), edges.end(), [](const Edge& edge) {
+        return edge.multiplicity[0] == 0 && edge.multiplicity[1] == 0;
+    }), edges.end());
+}
+
+// Buckets the edges by the bands of the plane they pass through, so a ray
+// only needs testing against the edges in its own band. The bands are
+// horizontal, for rays in the +x direction, or vertical if vertical is set.
+class BandIndex {
+    public:
+        BandIndex(const ArenaVector<Edge>& edges, bool vertical)
+            : m_edges(edges), m_vertical(vertical), m_lo(0.0), m_scale(0.0) {
+
+            double lo = std::numeric_limits<double>::max();
+            double hi = -lo;
+
+            for (const Edge& edge : edges) {
+                lo = std::min(lo, std::min(coord(edge.P), coord(edge.Q)));
+                hi = std::max(hi, std::max(coord(edge.P), coord(edge.Q)));
+            }
+
+            size_t numBands = std::max<size_t>(1, sqrt(static_cast<double>(edges.size())));
+
+            if (hi > lo) {
+                m_lo = lo;
+                m_scale = numBands / (hi - lo);
+            }
+
+            m_offsets.assign(numBands + 1, 0);
+
+            for (int pass = 0; pass < 2; ++pass) {
+                for (size_t i = 0; i < edges.size(); ++i) {
+                    const Edge& edge = edges[i];
+
+                    // Edges parallel to the rays never cross them
+                    if (coord(edge.P) == coord(edge.Q)) {
+                        continue;
+                    }
+
+                    size_t first = band(std::min(coord(edge.P), coord(edge.Q)));
+                    size_t last = band(std::max(coord(edge.P), coord(edge.Q)));
+
+                    for (size_t b = first; b <= last; ++b) {
+                        if (pass == 0) {
+                            ++m_offsets[b + 1];
+                        }
+                        else {
+                            m_indices[m_cursor[b]++] = i;
+                        }
+                    }
+                }
+
+                if (pass == 0) {
+                    for (size_t b = 0; b < numBands; ++b) {
+                        m_offsets[b + 1] += m_offsets[b];
+                    }
+
+                    m_indices.resize(m_offsets.back());
+                    m_cursor.assign(m_offsets.begin(), m_offsets.end() - 1);
+                }
+            }
+        }
+
+        // The operands' winding numbers at M, counting the edges other than
+        // the one at index skip that cross a ray cast from M
+        void winding(size_t skip, const Point& M, int (&w)[2]) const {
+            w[0] = 0;
+            w[1] = 0;
+
+            size_t b = band(coord(M));
+
+            for (size_t k = m_offsets[b]; k < m_offsets[b + 1]; ++k) {
+                size_t i = m_indices[k];
+
+                if (i == skip) {
+                    continue;
+                }
+
+                const Edge& edge = m_edges[i];
+
+                if (m_vertical) {
+                    if ((edge.P.x > M.x) != (edge.Q.x > M.x)) {
+                        double y = edge.P.y + (M.x - edge.P.x) * (edge.Q.y - edge.P.y) / (edge.Q.x - edge.P.x);
+
+                        // P is left of Q, so the edge runs rightwards
+                        if (y > M.y) {
+                            w[0] -= edge.multiplicity[0];
+                            w[1] -= edge.multiplicity[1];
+                        }
+                    }
+                }
+                else {
+                    if ((edge.P.y > M.y) != (edge.Q.y > M.y)) {
+                        double x = edge.P.x + (M.y - edge.P.y) * (edge.Q.x - edge.P.x) / (edge.Q.y - edge.P.y);
+
+                        if (x > M.x) {
+                            int sign = edge.Q.y > edge.P.y ? 1 : -1;
+
+                            w[0] += sign * edge.multiplicity[0];
+                            w[1] += sign * edge.multiplicity[1];
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        double coord(const Point& P) const {
+            return m_vertical ? P.x : P.y;
+        }
+
+        size_t band(double c) const {
+            double b = (c - m_lo) * m_scale;
+            size_t numBands = m_offsets.size() - 1;
+
+            return b <= 0.0 ? 0 : std::min(numBands - 1, static_cast<size_t>(b));
+        }
+
+        const ArenaVector<Edge>& m_edges;
+        bool m_vertical;
+        double m_lo;
+        double m_scale;
+        ArenaVector<size_t> m_offsets;
+        ArenaVector<size_t> m_cursor;
+        ArenaVector<size_t> m_indices;
+};
+
+// Keeps the edges that separate filled space from empty, swapping the ends
+// of each so the filled side is on its left
+static void selectBoundary(ArenaVector<Edge>& edges, ArenaVector<Edge>& boundary) {
+    BandIndex rows(edges, false);
+    BandIndex columns(edges, true);
+
+    for (size_t i = 0; i < edges.size(); ++i) {
+        const Edge& edge = edges[i];
+        Point M((edge.P.x + edge.Q.x) * 0.5, (edge.P.y + edge.Q.y) * 0.5);
+
+        int left[2];
+        int right[2];
+
+        if (edge.P.y == edge.Q.y) {
+            // Runs rightwards, so the left is above
+            columns.winding(i, M, left);
+
+            for (int j = 0; j < 2; ++j) {
+                right[j] = left[j] - edge.multiplicity[j];
+            }
+        }
+        else {
+            bool up = edge.Q.y > edge.P.y;
+            int sign = up ? 1 : -1;
+
+            int plus[2];
+            rows.winding(i, M, plus);
+
+            for (int j = 0; j < 2; ++j) {
+                int minus = plus[j] + sign * edge.multiplicity[j];
+
+                left[j] = up ? minus : plus[j];
+                right[j] = up ? plus[j] : minus;
+            }
+        }
+
+        bool leftFilled = left[0] != 0 || left[1] != 0;
+        bool rightFilled = right[0] != 0 || right[1] != 0;
+
+        if (leftFilled == rightFilled) {
+            continue;
+        }
+
+        if (leftFilled) {
+            boundary.push_back(Edge{edge.P, edge.Q, {1, 0}});
+        }
+        else {
+            boundary.push_back(Edge{edge.Q, edge.P, {1, 0}});
+        }
+    }
+}
+
+// Of the edges leaving the end of edge idx, returns the first clockwise from
+// the way back, which keeps separate faces touching at a vertex separate.
+static size_t nextEdge(const ArenaVector<Edge>& boundary, size_t idx) {
+    const Edge& edge = boundary[idx];
+
+    Edge key{edge.Q, edge.Q, {0, 0}};
+    auto range = std::equal_range(boundary.begin(), boundary.end(), key, [](const Edge& a, const Edge& b) {
+        return lessPoint(a.P, b.P);
+    });
+
+    double back = atan2(edge.P.y - edge.Q.y, edge.P.x - edge.Q.x);
+
+    size_t best = boundary.size();
+    double bestAngle = 0.0;
+
+    for (auto i = range.first; i != range.second; ++i) {
+        double angle = back - atan2(i->Q.y - i->P.y, i->Q.x - i->P.x);
+
+        while (angle <= 0.0) {
+            angle += 2.0 * M_PI;
+        }
+
+        while (angle > 2.0 * M_PI) {
+            angle -= 2.0 * M_PI;
+        }
+
+        if (best == boundary.size() || angle < bestAngle) {
+            best = i - boundary.begin();
+            bestAngle = angle;
+        }
+    }
+
+    return best;
+}
+
+static bool isCollinear(const Point& A, const Point& B, const Point& C) {
+    Point AC = C - A;
+    double d = cross(B - A, AC);
+
+    return d * d <= COLLINEAR_DISTANCE * COLLINEAR_DISTANCE * sqLength(AC);
+}
+
+static void appendLoop(Outline& outline, ArenaVector<Point>& loop) {
+    ArenaVector<Point> points;
+
+    for (const Point& P : loop) {
+        while (points.size() >= 2 && isCollinear(points[points.size() - 2], points.back(), P)) {
+            points.pop_back();
+        }
+
+        points.push_back(P);
+    }
+
+    // The loop wraps around, so its ends may be collinear too
+    while (points.size() >= 3 && isCollinear(points[points.size() - 2], points.back(), points[0])) {
+        points.pop_back();
+    }
+
+    size_t first = 0;
+    while (points.size() - first >= 3 && isCollinear(points.back(), points[first], points[first + 1])) {
+        ++first;
+    }
+
+    if (points.size() - first < 3) {
+        return;
+    }
+
+    outline.moveTo(points[first]);
+
+    for (size_t i = first + 1; i < points.size(); ++i) {
+        outline.lineTo(points[i]);
+    }
+
+    outline.lineTo(points[first]);
+}
+
+static bool stitch(ArenaVector<Edge>& boundary, Outline& outline) {
+    std::sort(boundary.begin(), boundary.end());
+
+    ArenaVector<bool> used(boundary.size(), false);
+    ArenaVector<Point> loop;
+
+    for (size_t start = 0; start < boundary.size(); ++start) {
+        if (used[start]) {
+            continue;
+        }
+
+        loop.clear();
+
+        size_t i = start;
+
+        while (true) {
+            used[i] = true;
+            loop.push_back(boundary[i].P);
+
+            size_t next = nextEdge(boundary, i);
+
+            if (next == start) {
+                break;
+            }
+
+            // A dangling or reused edge means the input defeated the arithmetic
+            if (next == boundary.size() || used[next]) {
+                return false;
+            }
+
+            i = next;
+        }
+
+        appendLoop(outline, loop);
+    }
+
+    return true;
+}
+
+bool nativeUnion(const Outline& linear1, const Outline& linear2, Outline& result) {
+    ArenaVector<Segment> segments;
+    appendSegments(segments, linear1, 0);
+    appendSegments(segments, linear2, 1);
+
+    ArenaVector<Split> splits;
+    findSplits(segments, splits);
+    mergeSplitPoints(segments, splits);
+    std::sort(splits.begin(), splits.end());
+
+    ArenaVector<Edge> edges;
+    buildEdges(segments, splits, edges);
+
+    ArenaVector<Edge> boundary;
+    selectBoundary(edges, boundary);
+
+    Outline outline;
+
+    if (!stitch(boundary, outline)) {
+        return false;
+    }
+
+    result = std::move(outline);
+    return true;
+}
+
+PathList nativeUnion(const PathList& linear1, const PathList& linear2) {
+    Outline result;
+
+    if (!nativeUnion(geometry::toOutline(linear1), geometry::toOutline(linear2), result)) {
+        throw GeometryException("Error computing union; Inconsistent boundary");
+    }
+
+    return geometry::toPathList(result);
+}
+
+
+}
+}
+}
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <cmath>
+#include "Arena.hpp"
+#include "Geometry.hpp"
+
+
+// Fits cubics to the polylines left in flattened output, after Schneider's
+// "An Algorithm for Automatically Fitting Digitized Curves" (Graphics Gems,
+// 1990):
+//
+//    1. Each contour is cut at its corners, and wherever a line meets a curve
+//       it already has, into runs of line segments.
+//    2. Each run is given parameters by chord length, and the cubic with the
+//       run's end tangents that fits it best, by least squares, is found.
+//    3. If that isn't within tolerance, the parameters are improved with a
+//       few Newton steps. Failing that, the run is split at its worst point
+//       and each half is fitted in turn.
+
+
+namespace csmerge {
+namespace geometry {
+namespace approx {
+
+
+double CURVE_FIT_TOLERANCE = 0; // Disabled by default
+
+// Vertices where the polyline turns by more than 60 degrees, the angle with
+// this cosine, are corners
+static const double CORNER_COSINE = 0.5;
+
+// Reparameterisation is only worth trying if the fit is this close
+static const double REPARAMETERISE_FACTOR = 16.0;
+
+static const int MAX_NEWTON_ITERATIONS = 20;
+
+
+static Point scale(const Point& a, double s) {
+    return Point(a.x * s, a.y * s);
+}
+
+static double dot(const Point& a, const Point& b) {
+    return a.x * b.x + a.y * b.y;
+}
+
+static double length(const Point& a) {
+    return sqrt(dot(a, a));
+}
+
+static Point normalise(const Point& a) {
+    double len = length(a);
+    return len > 0.0 ? scale(a, 1.0 / len) : a;
+}
+
+static Point bezierPoint(const Point* ctrl, int degree, double t) {
+    Point tmp[4];
+    std::copy(ctrl, ctrl + degree + 1, tmp);
+
+    for (int i = 1; i <= degree; ++i) {
+        for (int j = 0; j <= degree - i; ++j) {
+            tmp[j] = tmp[j] + scale(tmp[j + 1] - tmp[j], t);
+        }
+    }
+
+    return tmp[0];
+}
+
+static double distanceToLine(const Point& P, const Point& A, const Point& B) {
+    Point AB = B - A;
+    double len = length(AB);
+
+    if (len == 0.0) {
+        return length(P - A);
+    }
+
+    return fabs(AB.x * (P.y - A.y) - AB.y * (P.x - A.x)) / len;
+}
+
+
+// Fits cubics to one run of a polyline, appending them to an outline
+class CubicFitter {
+    public:
+        CubicFitter(const ArenaVector<Point>& points, double tolerance, Outline& outline)
+            : m_points(points),
+              m_tolerance(tolerance),
+              m_outline(outline) {}
+
+        void fit(size_t first, size_t last, const Point& tHat1, const Point& tHat2);
+
+    private:
+        void chordLengthParameterise(size_t first, size_t last, ArenaVector<double>& u) const;
+        void generateBezier(size_t first, size_t last, const ArenaVector<double>& u,
+            const Point& tHat1, const Point& tHat2, Point* bezier) const;
+        double maxError(size_t first, size_t last, const Point* bezier, const ArenaVector<double>& u,
+            size_t& split) const;
+        void reparameterise(size_t first, size_t last, const Point* bezier, ArenaVector<double>& u) const;
+
+        const ArenaVector<Point>& m_points;
+        double m_tolerance;
+        Outline& m_outline;
+};
+
+void CubicFitter::fit(size_t first, size_t last, const Point& tHat1, const Point& tHat2) {
+    const ArenaVector<Point>& d = m_points;
+
+    bool straight = true;
+
+    for (size_t i = first + 1; i < last && straight; ++i) {
+        straight = distanceToLine(d[i], d[first], d[last]) <= m_tolerance;
+    }
+
+    if (straight) {
+        m_outline.lineTo(d[last]);
+        return;
+    }
+
+    ArenaVector<double> u;
+    chordLengthParameterise(first, last, u);
+
+    Point bezier[4];
+    generateBezier(first, last, u, tHat1, tHat2, bezier);
+
+    size_t split = 0;
+    double error = maxError(first, last, bezier, u, split);
+
+    if (error > m_tolerance && error < m_tolerance * REPARAMETERISE_FACTOR) {
+        for (int i = 0; i < MAX_NEWTON_ITERATIONS && error > m_tolerance; ++i) {
+            reparameterise(first, last, bezier, u);
+            generateBezier(first, last, u, tHat1, tHat2, bezier);
+            error = maxError(first, last, bezier, u, split);
+        }
+    }
+
+    if (error <= m_tolerance) {
+        m_outline.curveTo(bezier[1], bezier[2], d[last]);
+        return;
+    }
+
+    Point tHatCenter = normalise(d[split - 1] - d[split + 1]);
+
+    fit(first, split, tHat1, tHatCenter);
+    fit(split, last, scale(tHatCenter, -1.0), tHat2);
+}
+
+void CubicFitter::chordLengthParameterise(size_t first, size_t last, ArenaVector<double>& u) const {
+    u.resize(last - first + 1);
+    u[0] = 0.0;
+
+    for (size_t i = first + 1; i <= last; ++i) {
+        u[i - first] = u[i - first - 1] + length(m_points[i] - m_points[i - 1]);
+    }
+
+    double total = u.back();
+
+    for (size_t i = 1; i < u.size(); ++i) {
+        u[i] /= total;
+    }
+}
+
+// The cubic from d[first] to d[last], with the given end tangents, whose
+// distances from the points at their parameters have the least squared sum
+void CubicFitter::generateBezier(size_t first, size_t last, const ArenaVector<double>& u,
+    const Point& tHat1, const Point& tHat2, Point* bezier) const {
+
+    const Point& P0 = m_points[first];
+    const Point& P3 = m_points[last];
+
+    double C[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+    double X[2] = { 0.0, 0.0 };
+
+    for (size_t i = 0; i < u.size(); ++i) {
+        double t = u[i];
+        double s = 1.0 - t;
+        double b0 = s * s * s;
+        double b1 = 3.0 * s * s * t;
+        double b2 = 3.0 * s * t * t;
+        double b3 = t * t * t;
+
+        Point A1 = scale(tHat1, b1);
+        Point A2 = scale(tHat2, b2);
+
+        C[0][0] += dot(A1, A1);
+        C[0][1] += dot(A1, A2);
+        C[1][1] += dot(A2, A2);
+
+        Point tmp = m_points[first + i] - (scale(P0, b0 + b1) + scale(P3, b2 + b3));
+
+        X[0] += dot(A1, tmp);
+        X[1] += dot(A2, tmp);
+    }
+
+    C[1][0] = C[0][1];
+
+    double det = C[0][0] * C[1][1] - C[1][0] * C[0][1];
+    double alpha1 = 0.0;
+    double alpha2 = 0.0;
+
+    if (det != 0.0) {
+        alpha1 = (X[0] * C[1][1] - X[1] * C[0][1]) / det;
+        alpha2 = (C[0][0] * X[1] - C[1][0] * X[0]) / det;
+    }
+
+    // Without a usable solution, fall back on Wu and Barsky's heuristic
+    double segLength = length(P3 - P0);
+    double epsilon = 1e-6 * segLength;
+
+    if (alpha1 < epsilon || alpha2 < epsilon) {
+        alpha1 = alpha2 = segLength / 3.0;
+    }
+
+    bezier[0] = P0;
+    bezier[1] = P0 + scale(tHat1, alpha1);
+    bezier[2] = P3 + scale(tHat2, alpha2);
+    bezier[3] = P3;
+}
+
+// The greatest distance of a point from the cubic at its parameter, and
+// where it is
+double CubicFitter::maxError(size_t first, size_t last, const Point* bezier,
+    const ArenaVector<double>& u, size_t& split) const {
+
+    double worst = 0.0;
+    split = (first + last + 1) / 2;
+
+    for (size_t i = first + 1; i < last; ++i) {
+        double dist = length(bezierPoint(bezier, 3, u[i - first]) - m_points[i]);
+
+        if (dist > worst) {
+            worst = dist;
+            split = i;
+        }
+    }
+
+    return worst;
+}
+
+// One Newton-Raphson step on each parameter towards the nearest point on
+// the cubic
+void CubicFitter::reparameterise(size_t first, size_t last, const Point* bezier,
+    ArenaVector<double>& u) const {
+
+    Point d1[3];
+    Point d2[2];
+
+    for (int i = 0; i < 3; ++i) {
+        d1[i] = scale(bezier[i + 1] - bezier[i], 3.0);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        d2[i] = scale(d1[i + 1] - d1[i], 2.0);
+    }
+
+    for (size_t i = first + 1; i < last; ++i) {
+        double t = u[i - first];
+
+        Point Q = bezierPoint(bezier, 3, t) - m_points[i];
+        Point Q1 = bezierPoint(d1, 2, t);
+        Point Q2 = bezierPoint(d2, 1, t);
+
+        double numerator = dot(Q, Q1);
+        double denominator = dot(Q1, Q1) + dot(Q, Q2);
+
+        if (denominator != 0.0) {
+            u[i - first] = std::max(0.0, std::min(1.0, t - numerator / denominator));
+        }
+    }
+}
+
+
+static bool isCorner(const Point& prev, const Point& P, const Point& next) {
+    Point a = normalise(P - prev);
+    Point b = normalise(next - P);
+
+    return dot(a, b) < CORNER_COSINE;
+}
+
+// Appends the lines of a contour from vertex first to vertex last, which are
+// corners, or ends of curves, with no others between. If the run is the
+// whole of a smooth contour, its ends are no corner, and get the tangent
+// there.
+static void fitRun(const ArenaVector<Point>& points, size_t first, size_t last, bool smooth,
+    double tolerance, Outline& outline) {
+
+    if (last == first + 1) {
+        outline.lineTo(points[last]);
+        return;
+    }
+
+    Point tHat1 = normalise(points[first + 1] - points[first]);
+    Point tHat2 = normalise(points[last - 1] - points[last]);
+
+    if (smooth) {
+        tHat1 = normalise(points[first + 1] - points[last - 1]);
+        tHat2 = scale(tHat1, -1.0);
+    }
+
+    CubicFitter fitter(points, tolerance, outline);
+    fitter.fit(first, last, tHat1, tHat2);
+}
+
+static void fitContour(const Outline::Contour& contour, double tolerance, Outline& outline) {
+    // Vertices along the contour, without repeats, and whether each edge to
+    // the next vertex is a cubic, whose inner control points are kept aside
+    ArenaVector<Point> V;
+    ArenaVector<const Point*> cubic;
+
+    const Point* A = contour.points;
+    V.push_back(A[0]);
+
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        if (contour.verbs[i] == Outline::CUBIC) {
+            cubic.push_back(A);
+            V.push_back(A[3]);
+            A += 3;
+        }
+        else {
+            if (A[1].x != V.back().x || A[1].y != V.back().y) {
+                cubic.push_back(nullptr);
+                V.push_back(A[1]);
+            }
+
+            A += 1;
+        }
+    }
+
+    size_t m = V.size() - 1;
+
+    if (m < 2 || V[m].x != V[0].x || V[m].y != V[0].y) {
+        outline.append(contour);
+        return;
+    }
+
+    V.pop_back();
+
+    // Vertices where runs of lines must end
+    ArenaVector<uint8_t> breaks(m, 0);
+
+    for (size_t i = 0; i < m; ++i) {
+        size_t prev = (i + m - 1) % m;
+
+        breaks[i] = cubic[prev] != nullptr || cubic[i] != nullptr
+            || isCorner(V[prev], V[i], V[(i + 1) % m]);
+    }
+
+    size_t start = std::find(breaks.begin(), breaks.end(), 1) - breaks.begin();
+    bool smooth = start == m;
+
+    if (smooth) {
+        start = 0;
+    }
+
+    // Unrolled, so the runs never wrap around
+    ArenaVector<Point> points;
+
+    for (size_t k = 0; k <= m; ++k) {
+        points.push_back(V[(start + k) % m]);
+    }
+
+    outline.moveTo(points[0]);
+
+    size_t first = 0;
+
+    for (size_t k = 0; k < m; ++k) {
+        size_t i = (start + k) % m;
+
+        if (cubic[i] != nullptr) {
+            outline.curveTo(cubic[i][1], cubic[i][2], points[k + 1]);
+            first = k + 1;
+        }
+        else if (k + 1 == m || breaks[(i + 1) % m]) {
+            fitRun(points, first, k + 1, smooth, tolerance, outline);
+            first = k + 1;
+        }
+    }
+}
+
+Outline fitCurves(const Outline& outline, double tolerance) {
+    Outline result;
+    result.reserve(outline.verbs().size(), outline.points().size());
+
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        fitContour(outline.contour(i), tolerance, result);
+    }
+
+    return result;
+}
+
+PathList fitCurves(const PathList& paths, double tolerance) {
+    return geometry::toPathList(fitCurves(geometry::toOutline(paths), tolerance));
+}
+
+
+}
+}
+}
@@ -1,8 +1,12 @@
+#include <algorithm>
 #include <cmath>
 #include <functional>
+#include <limits>
+#include <new>
 #include <sstream>
 #include <CGAL/assertions_behaviour.h>
 #include <CGAL/squared_distance_2.h>
+#include "Arena.hpp"
 #include "Geometry.hpp"
 #include "Util.hpp"
 
@@ -34,6 +38,13 @@ class CgalException : public GeometryException {
 double FLOAT_PRECISION = 0.001;
 double MIN_LSEG_LENGTH = 0.001; // Set arbitrarily small, so MAX_LSEGS_PER_BEZIER dominates
 double MAX_LSEGS_PER_BEZIER = 10;
+double FLATTENING_TOLERANCE = 0; // Disabled by default
+bool USE_LINEAR_ENGINE = false;
+
+
+void setRelativeFlatteningTolerance(double fraction, double unitsPerEm) {
+    FLATTENING_TOLERANCE = fraction * unitsPerEm;
+}
 
 
 NoncontiguousCurvesException::NoncontiguousCurvesException(const Point& pathEnd, const Point& curveStart)
@@ -52,83 +63,129 @@ std::string NoncontiguousCurvesException::constructMsg(const Point& pathEnd,
 }
 
 
-static bool isLinear(const cgal_wrap::BezierCurve& curve) {
-    return curve.number_of_control_points() == 2;
+static Point lerp(const Point& A, const Point& B, double t) {
+    return Point(A.x + t * (B.x - A.x), A.y + t * (B.y - A.y));
 }
 
-static Path toPath(const cgal_wrap::BezierPolygon& poly) {
-    Path path;
-
-    for (auto c = poly.curves_begin(); c != poly.curves_end(); ++c) {
-        cgal_wrap::BezierCurve curve = cubicBezierFromXMonoSection(*c);
-        size_t n = curve.number_of_control_points();
+// De Casteljau's algorithm; splits the cubic at t into the part before and
+// the part after
+static void splitCubic(const Point* ctrl, double t, Point* before, Point* after) {
+    Point AB = lerp(ctrl[0], ctrl[1], t);
+    Point BC = lerp(ctrl[1], ctrl[2], t);
+    Point CD = lerp(ctrl[2], ctrl[3], t);
+    Point ABC = lerp(AB, BC, t);
+    Point BCD = lerp(BC, CD, t);
+    Point M = lerp(ABC, BCD, t);
 
-        if (isLinear(curve)) {
-            Point A = curve.control_point(0);
-            Point B = curve.control_point(n - 1);
+    before[0] = ctrl[0];
+    before[1] = AB;
+    before[2] = ABC;
+    before[3] = M;
 
-            try {
-                path.append(LineSegment(A, B));
-            }
-            catch (NoncontiguousCurvesException& ex) {
-                NON_FATAL("CGAL polygon boundary is noncontiguous");
+    after[0] = M;
+    after[1] = BCD;
+    after[2] = CD;
+    after[3] = ctrl[3];
+}
 
-                Point end = path.finalPoint();
-                path.append(LineSegment(end, B));
-            }
-        }
-        else {
-            assert(n == 4);
+// Control points of the part of the cubic between parameters t0 < t1
+static void subCubic(const Point* ctrl, double t0, double t1, Point* out) {
+    Point head[4];
+    Point tail[4];
 
-            Point A = curve.control_point(0);
-            Point B = curve.control_point(1);
-            Point C = curve.control_point(2);
-            Point D = curve.control_point(3);
+    std::copy(ctrl, ctrl + 4, head);
 
-            try {
-                path.append(CubicBezier(A, B, C, D));
-            }
-            catch (NoncontiguousCurvesException& ex) {
-                NON_FATAL("CGAL polygon boundary is noncontiguous");
+    if (t1 < 1.0) {
+        splitCubic(ctrl, t1, head, tail);
+    }
 
-                Point end = path.finalPoint();
-                path.append(CubicBezier(end, B, C, D));
-            }
-        }
+    if (t0 > 0.0) {
+        splitCubic(head, t0 / t1, tail, out);
     }
+    else {
+        std::copy(head, head + 4, out);
+    }
+}
 
-    return path;
+static double cross(const Point& a, const Point& b) {
+    return a.x * b.y - a.y * b.x;
 }
 
-static void errorHandler(const char* type, const char* expression,
-    const char* file, int line, const char* explanation) {
+double signedArea(const Outline::Contour& contour) {
+    // Relative to the start, so the products don't lose the area to
+    // cancellation far from the origin
+    const Point& O = contour.initialPoint();
+    const Point* A = contour.points;
 
-    throw CgalException(type, expression, file, line, explanation);
-}
+    double area = 0.0;
 
-static void warningHandler(const char* type, const char* expression,
-    const char* file, int line, const char* explanation) {
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        Point P0 = A[0] - O;
 
-    throw CgalException(type, expression, file, line, explanation);
-}
+        if (contour.verbs[i] == Outline::CUBIC) {
+            Point P1 = A[1] - O;
+            Point P2 = A[2] - O;
+            Point P3 = A[3] - O;
 
-void initialise() {
-    CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
-    CGAL::set_warning_behaviour(CGAL::CONTINUE);
-    CGAL::set_error_handler(&errorHandler);
-    CGAL::set_warning_handler(&warningHandler);
+            // Green's theorem over the cubic, integrated exactly
+            area += (6.0 * cross(P0, P1) + 3.0 * cross(P0, P2) + cross(P0, P3)
+                + 3.0 * cross(P1, P2) + 3.0 * cross(P1, P3) + 6.0 * cross(P2, P3)) / 20.0;
+
+            A += 3;
+        }
+        else {
+            area += cross(P0, A[1] - O) / 2.0;
+            A += 1;
+        }
+    }
+
+    return area;
 }
 
-cgal_wrap::BezierCurve cubicBezierFromXMonoSection(const cgal_wrap::BezierXMonotoneCurve& mono) {
-    cgal_wrap::BezierCurve supportCurve = mono.supporting_curve();
+// Areas this small, relative to the square of the contour's largest
+// coordinate, may have the wrong sign after rounding
+static const double AREA_SIGN_TOLERANCE = 1e-9;
+
+// A contour's signed area, and the orientation it gives, or COLLINEAR where
+// the area is too small for its sign to be trusted
+struct ContourArea {
+    double area;
+    CGAL::Orientation orientation;
+};
+
+static ContourArea contourArea(const Outline::Contour& contour) {
+    BoundingBox box = contour.bbox();
+    double extent = std::max(std::max(fabs(box.xmin), fabs(box.xmax)),
+        std::max(fabs(box.ymin), fabs(box.ymax)));
+
+    ContourArea result;
+    result.area = signedArea(contour);
+    result.orientation = CGAL::COLLINEAR;
 
-    double t0 = mono.parameter_range().first;
-    double t1 = mono.parameter_range().second;
+    if (fabs(result.area) > AREA_SIGN_TOLERANCE * extent * extent) {
+        result.orientation = result.area > 0.0 ? CGAL::COUNTERCLOCKWISE : CGAL::CLOCKWISE;
+    }
+
+    return result;
+}
 
+// The part of the curve between parameters t0 and t1, running from t0 to t1
+static cgal_wrap::BezierCurve subCurve(const cgal_wrap::BezierCurve& supportCurve, double t0, double t1) {
     if (t0 == 0.0 && t1 == 1.0) {
         return supportCurve;
     }
 
+    if (t0 > t1) {
+        cgal_wrap::BezierCurve forward = subCurve(supportCurve, t1, t0);
+        ArenaList<cgal_wrap::BezierRatPoint> pts;
+
+        for (size_t i = 0; i < forward.number_of_control_points(); ++i) {
+            pts.push_front(forward.control_point(i));
+        }
+
+        return cgal_wrap::BezierCurve(pts.begin(), pts.end());
+    }
+
     // If the curve is a line segment, there's no need to use De Casteljau's
     if (supportCurve.number_of_control_points() == 2) {
         cgal_wrap::BezierRatPoint A = supportCurve.control_point(0);
@@ -145,20 +202,20 @@ cgal_wrap::BezierCurve cubicBezierFromXMonoSection(const cgal_wrap::BezierXMonot
         cgal_wrap::BezierRatPoint A_(ax + (bx - ax) * t0_, ay + (by - ay) * t0_);
         cgal_wrap::BezierRatPoint B_(ax + (bx - ax) * t1_, ay + (by - ay) * t1_);
 
-        std::list<cgal_wrap::BezierRatPoint> pts;
+        ArenaList<cgal_wrap::BezierRatPoint> pts;
         pts.push_back(A_);
         pts.push_back(B_);
 
         return cgal_wrap::BezierCurve(pts.begin(), pts.end());
     }
 
-    std::list<cgal_wrap::BezierRatPoint> ctrlPoints;
+    ArenaList<cgal_wrap::BezierRatPoint> ctrlPoints;
 
     for (size_t i = 0; i < supportCurve.number_of_control_points(); ++i) {
         ctrlPoints.push_back(supportCurve.control_point(i));
     }
 
-    std::list<cgal_wrap::BezierRatPoint> leftCtrlPoints, rightCtrlPoints;
+    ArenaList<cgal_wrap::BezierRatPoint> leftCtrlPoints, rightCtrlPoints;
 
     CGAL::de_Casteljau_2(ctrlPoints.begin(), ctrlPoints.end(), t0,
         std::back_inserter(leftCtrlPoints), std::front_inserter(rightCtrlPoints));
@@ -168,7 +225,7 @@ cgal_wrap::BezierCurve cubicBezierFromXMonoSection(const cgal_wrap::BezierXMonot
     double t1_ = (t1 - t0) / (1.0 - t0);
 
     leftCtrlPoints.clear(); // We can reuse this list
-    std::list<cgal_wrap::BezierRatPoint> rightRightCtrlPoints;
+    ArenaList<cgal_wrap::BezierRatPoint> rightRightCtrlPoints;
 
     CGAL::de_Casteljau_2(rightCtrlPoints.begin(), rightCtrlPoints.end(), t1_,
         std::back_inserter(leftCtrlPoints), std::front_inserter(rightRightCtrlPoints));
@@ -176,96 +233,228 @@ cgal_wrap::BezierCurve cubicBezierFromXMonoSection(const cgal_wrap::BezierXMonot
     return cgal_wrap::BezierCurve(leftCtrlPoints.begin(), leftCtrlPoints.end());
 }
 
-PathList toPathList(const cgal_wrap::PolyList& polyList) {
-    PathList paths;
+cgal_wrap::BezierCurve cubicBezierFromXMonoSection(const cgal_wrap::BezierXMonotoneCurve& mono) {
+    return subCurve(mono.supporting_curve(), mono.parameter_range().first, mono.parameter_range().second);
+}
 
-    for (auto i = polyList.begin(); i != polyList.end(); ++i) {
-        const cgal_wrap::BezierPolygonWithHoles& poly = *i;
-        const cgal_wrap::BezierPolygon& outer = poly.outer_boundary();
+// As subCurve, but subdivided in double precision, for when the result is
+// only wanted as Points. Returns the number of control points.
+static size_t subCurvePoints(const cgal_wrap::BezierCurve& supportCurve, double t0, double t1, Point* out) {
+    size_t n = supportCurve.number_of_control_points();
+    assert(n == 2 || n == 4);
 
-        paths.push_back(toPath(outer));
+    Point ctrl[4];
 
-        for (auto j = poly.holes_begin(); j != poly.holes_end(); ++j) {
-            paths.push_back(toPath(*j));
-        }
+    for (size_t i = 0; i < n; ++i) {
+        ctrl[i] = supportCurve.control_point(i);
+    }
+
+    if (n == 2) {
+        out[0] = t0 == 0.0 ? ctrl[0] : lerp(ctrl[0], ctrl[1], t0);
+        out[1] = t1 == 1.0 ? ctrl[1] : lerp(ctrl[0], ctrl[1], t1);
+
+        return n;
     }
 
-    return paths;
+    subCubic(ctrl, std::min(t0, t1), std::max(t0, t1), out);
+
+    if (t0 > t1) {
+        std::swap(out[0], out[3]);
+        std::swap(out[1], out[2]);
+    }
+
+    return n;
 }
 
-cgal_wrap::PolyList toPolyList(const PathList& paths) {
-    cgal_wrap::Traits traits;
-    cgal_wrap::Traits::Make_x_monotone_2 fnMakeXMonotone = traits.make_x_monotone_2_object();
+size_t controlPointsOfXMonoSection(const cgal_wrap::BezierXMonotoneCurve& mono, Point* out) {
+    return subCurvePoints(mono.supporting_curve(), mono.parameter_range().first, mono.parameter_range().second,
+        out);
+}
 
-    cgal_wrap::PolyList polyList; // The final polygons with holes
-    cgal_wrap::BezierPolygon outerPoly;
-    std::list<cgal_wrap::BezierPolygon> holes;
+// Whether the x-monotone curve picks up where prev left off along the same
+// supporting curve, in the same direction
+static bool continuesCurve(const cgal_wrap::BezierXMonotoneCurve& prev,
+    const cgal_wrap::BezierXMonotoneCurve& mono) {
 
-    // For each path in the list
-    for (auto i = paths.begin(); i != paths.end(); ++i) {
-        const Path& path = *i;
+    std::pair<double, double> r0 = prev.parameter_range();
+    std::pair<double, double> r1 = mono.parameter_range();
 
-        if (path.empty()) {
-            continue;
+    return mono.supporting_curve().is_same(prev.supporting_curve())
+        && r1.first == r0.second
+        && (r0.first < r0.second) == (r1.first < r1.second);
+}
+
+// Appends the polygon's boundary to the outline as a new contour. Each run
+// of x-monotone pieces that continue one another along the same curve, such
+// as a curve split at its horizontal tangents, becomes a single sub-curve.
+static void appendContour(Outline& outline, const cgal_wrap::BezierPolygon& poly) {
+    ArenaVector<const cgal_wrap::BezierXMonotoneCurve*> pieces;
+
+    for (auto c = poly.curves_begin(); c != poly.curves_end(); ++c) {
+        pieces.push_back(&*c);
+    }
+
+    size_t n = pieces.size();
+
+    // Start where a run begins, so that none wraps around the end
+    size_t start = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!continuesCurve(*pieces[(i + n - 1) % n], *pieces[i])) {
+            start = i;
+            break;
         }
+    }
+
+    bool first = true;
+
+    for (size_t k = 0; k < n;) {
+        const cgal_wrap::BezierXMonotoneCurve& mono = *pieces[(start + k) % n];
+
+        size_t len = 1;
 
-        if (!path.isClosed()) {
-            throw GeometryException("Cannot make polygon from path; Path is not closed");
+        while (k + len < n && continuesCurve(*pieces[(start + k + len - 1) % n], *pieces[(start + k + len) % n])) {
+            ++len;
         }
 
-        std::list<cgal_wrap::BezierXMonotoneCurve> monoCurves;
+        double t0 = mono.parameter_range().first;
+        double t1 = pieces[(start + k + len - 1) % n]->parameter_range().second;
 
-        // For each curve in the path
-        for (size_t j = 0; j < path.size(); ++j) {
-            const Curve& curve = path[j];
+        Point ctrl[4];
+        size_t numCtrl = subCurvePoints(mono.supporting_curve(), t0, t1, ctrl);
 
-            std::list<cgal_wrap::BezierRatPoint> points;
+        if (first) {
+            outline.moveTo(ctrl[0]);
+            first = false;
+        }
+        else if (ctrl[0] != outline.points().back()) {
+            // The curve is joined to the end of the contour regardless
+            NON_FATAL("CGAL polygon boundary is noncontiguous");
+        }
 
-            if (curve.type() == LineSegment::type) {
-                const LineSegment& lseg = dynamic_cast<const LineSegment&>(curve);
+        if (numCtrl == 2) {
+            outline.lineTo(ctrl[1]);
+        }
+        else {
+            outline.curveTo(ctrl[1], ctrl[2], ctrl[3]);
+        }
 
-                points.push_back(cgal_wrap::BezierRatPoint(lseg.A()));
-                points.push_back(cgal_wrap::BezierRatPoint(lseg.B()));
-            }
-            else if (curve.type() == CubicBezier::type) {
-                const CubicBezier& bezier = dynamic_cast<const CubicBezier&>(curve);
+        k += len;
+    }
+}
 
-                points.push_back(cgal_wrap::BezierRatPoint(bezier.A()));
-                points.push_back(cgal_wrap::BezierRatPoint(bezier.B()));
-                points.push_back(cgal_wrap::BezierRatPoint(bezier.C()));
-                points.push_back(cgal_wrap::BezierRatPoint(bezier.D()));
-            }
-            else {
-                throw GeometryException("Curve type is not recognised");
-            }
+static void errorHandler(const char* type, const char* expression,
+    const char* file, int line, const char* explanation) {
 
-            if (j + 1 == path.size()) {
-                cgal_wrap::BezierRatPoint start = path.initialPoint();
+    throw CgalException(type, expression, file, line, explanation);
+}
 
-                points.pop_back();
-                points.push_back(start);
-            }
+static void warningHandler(const char* type, const char* expression,
+    const char* file, int line, const char* explanation) {
 
-            cgal_wrap::BezierCurve cgalCurve(points.begin(), points.end());
-            std::list<CGAL::Object> monoObjs;
-            fnMakeXMonotone(cgalCurve, std::back_inserter(monoObjs));
+    throw CgalException(type, expression, file, line, explanation);
+}
 
-            // Append the x-monotone curves to the list
-            cgal_wrap::BezierXMonotoneCurve monoCurve;
-            for (auto o = monoObjs.begin(); o != monoObjs.end(); ++o) {
-                if (CGAL::assign(monoCurve, *o)) {
-                    monoCurves.push_back(monoCurve);
-                }
+void initialise() {
+    CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
+    CGAL::set_warning_behaviour(CGAL::CONTINUE);
+    CGAL::set_error_handler(&errorHandler);
+    CGAL::set_warning_handler(&warningHandler);
+}
+
+Outline toOutline(const cgal_wrap::PolyList& polyList) {
+    Outline outline;
+
+    for (auto i = polyList.begin(); i != polyList.end(); ++i) {
+        const cgal_wrap::BezierPolygonWithHoles& poly = *i;
+        const cgal_wrap::BezierPolygon& outer = poly.outer_boundary();
+
+        appendContour(outline, outer);
+
+        for (auto j = poly.holes_begin(); j != poly.holes_end(); ++j) {
+            appendContour(outline, *j);
+        }
+    }
+
+    return outline;
+}
+
+PathList toPathList(const cgal_wrap::PolyList& polyList) {
+    return toPathList(toOutline(polyList));
+}
+
+// Converts a closed contour to a polygon of x-monotone curves
+static cgal_wrap::BezierPolygon toBezierPolygon(const Outline::Contour& contour,
+    cgal_wrap::Traits::Make_x_monotone_2& fnMakeXMonotone) {
+
+    if (!contour.isClosed()) {
+        throw GeometryException("Cannot make polygon from path; Path is not closed");
+    }
+
+    ArenaList<cgal_wrap::BezierXMonotoneCurve> monoCurves;
+    const Point* A = contour.points;
+
+    // For each curve in the contour
+    for (size_t j = 0; j < contour.numVerbs; ++j) {
+        ArenaList<cgal_wrap::BezierRatPoint> points;
+
+        if (contour.verbs[j] == Outline::LINE) {
+            points.push_back(cgal_wrap::BezierRatPoint(A[0]));
+            points.push_back(cgal_wrap::BezierRatPoint(A[1]));
+            A += 1;
+        }
+        else {
+            points.push_back(cgal_wrap::BezierRatPoint(A[0]));
+            points.push_back(cgal_wrap::BezierRatPoint(A[1]));
+            points.push_back(cgal_wrap::BezierRatPoint(A[2]));
+            points.push_back(cgal_wrap::BezierRatPoint(A[3]));
+            A += 3;
+        }
+
+        if (j + 1 == contour.numVerbs) {
+            cgal_wrap::BezierRatPoint start = contour.initialPoint();
+
+            points.pop_back();
+            points.push_back(start);
+        }
+
+        cgal_wrap::BezierCurve cgalCurve(points.begin(), points.end());
+        ArenaList<CGAL::Object> monoObjs;
+        fnMakeXMonotone(cgalCurve, std::back_inserter(monoObjs));
+
+        // Append the x-monotone curves to the list
+        cgal_wrap::BezierXMonotoneCurve monoCurve;
+        for (auto o = monoObjs.begin(); o != monoObjs.end(); ++o) {
+            if (CGAL::assign(monoCurve, *o)) {
+                monoCurves.push_back(monoCurve);
             }
         }
+    }
+
+    return cgal_wrap::BezierPolygon(monoCurves.begin(), monoCurves.end());
+}
+
+// Counter-clockwise polygons are outer boundaries, and any others are holes
+// of the outer boundary preceding them. Orientations come from the areas of
+// the contours, given in the same order, and only those too small to be sure
+// of are left to the polygon's exact predicates.
+template <class Polygon, class PolygonWithHoles, class It>
+static std::vector<PolygonWithHoles> assemblePolyList(It begin, It end, const ContourArea* areas) {
+    std::vector<PolygonWithHoles> polyList; // The final polygons with holes
+    Polygon outerPoly;
+    ArenaList<Polygon> holes;
 
-        // Add the new polygon to the list
+    for (It i = begin; i != end; ++i, ++areas) {
+        const Polygon& subPoly = *i;
+        CGAL::Orientation orientation = areas->orientation;
 
-        cgal_wrap::BezierPolygon subPoly(monoCurves.begin(), monoCurves.end());
+        if (orientation == CGAL::COLLINEAR) {
+            orientation = subPoly.orientation();
+        }
 
-        if (subPoly.orientation() == CGAL::COUNTERCLOCKWISE) {
+        if (orientation == CGAL::COUNTERCLOCKWISE) {
             if (!outerPoly.is_empty()) {
-                polyList.push_back(cgal_wrap::BezierPolygonWithHoles(outerPoly, holes.begin(), holes.end()));
+                polyList.push_back(PolygonWithHoles(outerPoly, holes.begin(), holes.end()));
                 holes.clear();
             }
 
@@ -281,12 +470,36 @@ cgal_wrap::PolyList toPolyList(const PathList& paths) {
     }
 
     if (!outerPoly.is_empty()) {
-        polyList.push_back(cgal_wrap::BezierPolygonWithHoles(outerPoly, holes.begin(), holes.end()));
+        polyList.push_back(PolygonWithHoles(outerPoly, holes.begin(), holes.end()));
     }
 
     return polyList;
 }
 
+cgal_wrap::PolyList toPolyList(const Outline& outline) {
+    cgal_wrap::Traits traits;
+    cgal_wrap::Traits::Make_x_monotone_2 fnMakeXMonotone = traits.make_x_monotone_2_object();
+
+    ArenaVector<cgal_wrap::BezierPolygon> polygons;
+    ArenaVector<ContourArea> areas;
+
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        Outline::Contour contour = outline.contour(i);
+
+        if (!contour.empty()) {
+            polygons.push_back(toBezierPolygon(contour, fnMakeXMonotone));
+            areas.push_back(contourArea(contour));
+        }
+    }
+
+    return assemblePolyList<cgal_wrap::BezierPolygon, cgal_wrap::BezierPolygonWithHoles>(polygons.begin(),
+        polygons.end(), areas.data());
+}
+
+cgal_wrap::PolyList toPolyList(const PathList& paths) {
+    return toPolyList(toOutline(paths));
+}
+
 
 Point::Point()
     : x(0), y(0) {}
@@ -351,17 +564,52 @@ std::ostream& operator<<(std::ostream& out, const Point& pt) {
 }
 
 
-Curve::Curve(size_t typeId)
-    : m_type(typeId) {}
+BoundingBox::BoundingBox()
+    : xmin(std::numeric_limits<double>::infinity()),
+      ymin(std::numeric_limits<double>::infinity()),
+      xmax(-std::numeric_limits<double>::infinity()),
+      ymax(-std::numeric_limits<double>::infinity()) {}
+
+void BoundingBox::extend(const Point& P) {
+    xmin = std::min(xmin, P.x);
+    ymin = std::min(ymin, P.y);
+    xmax = std::max(xmax, P.x);
+    ymax = std::max(ymax, P.y);
+}
+
+void BoundingBox::extend(const BoundingBox& box) {
+    xmin = std::min(xmin, box.xmin);
+    ymin = std::min(ymin, box.ymin);
+    xmax = std::max(xmax, box.xmax);
+    ymax = std::max(ymax, box.ymax);
+}
 
-size_t Curve::type() const {
-    return m_type;
+bool BoundingBox::empty() const {
+    return xmin > xmax;
 }
 
+bool BoundingBox::contains(const BoundingBox& rhs) const {
+    return rhs.xmin >= xmin && rhs.xmax <= xmax && rhs.ymin >= ymin && rhs.ymax <= ymax;
+}
+
+bool BoundingBox::overlaps(const BoundingBox& rhs) const {
+    return xmin <= rhs.xmax + FLOAT_PRECISION && rhs.xmin <= xmax + FLOAT_PRECISION
+        && ymin <= rhs.ymax + FLOAT_PRECISION && rhs.ymin <= ymax + FLOAT_PRECISION;
+}
+
+std::ostream& operator<<(std::ostream& out, const BoundingBox& box) {
+    out << "[" << Point(box.xmin, box.ymin) << ", " << Point(box.xmax, box.ymax) << "]";
+    return out;
+}
+
+
+Curve::Curve(size_t typeId)
+    : m_type(typeId) {}
+
 Curve::~Curve() {}
 
 
-size_t LineSegment::type = std::hash<std::string>()("csmerge_LineSegment");
+constexpr size_t LineSegment::type;
 
 
 LineSegment::LineSegment(const Point& A, const Point& B)
@@ -400,7 +648,7 @@ bool LineSegment::operator==(const Curve& rhs) const {
         return false;
     }
 
-    const LineSegment& r = dynamic_cast<const LineSegment&>(rhs);
+    const LineSegment& r = static_cast<const LineSegment&>(rhs);
 
     return A() == r.A() && B() == r.B();
 }
@@ -412,7 +660,7 @@ bool LineSegment::operator!=(const Curve& rhs) const {
 LineSegment::~LineSegment() {}
 
 
-size_t CubicBezier::type = std::hash<std::string>()("csmerge_CubicBezier");
+constexpr size_t CubicBezier::type;
 
 
 CubicBezier::CubicBezier(const Point& A, const Point& B, const Point& C, const Point& D)
@@ -459,7 +707,7 @@ bool CubicBezier::operator==(const Curve& rhs) const {
         return false;
     }
 
-    const CubicBezier& r = dynamic_cast<const CubicBezier&>(rhs);
+    const CubicBezier& r = static_cast<const CubicBezier&>(rhs);
 
     return A() == r.A() && B() == r.B() && C() == r.C() && D() == r.D();
 }
@@ -477,29 +725,73 @@ std::ostream& operator<<(std::ostream& out, const Curve& curve) {
 }
 
 
+AnyCurve::AnyCurve(const Curve& curve) {
+    construct(curve);
+}
+
+AnyCurve::AnyCurve(const AnyCurve& cpy) {
+    construct(*cpy);
+}
+
+AnyCurve& AnyCurve::operator=(const AnyCurve& rhs) {
+    if (this != &rhs) {
+        destroy();
+        construct(*rhs);
+    }
+
+    return *this;
+}
+
+void AnyCurve::construct(const Curve& curve) {
+    m_type = curve.type();
+
+    if (m_type == LineSegment::type) {
+        new (&m_lseg) LineSegment(static_cast<const LineSegment&>(curve));
+    }
+    else if (m_type == CubicBezier::type) {
+        new (&m_bezier) CubicBezier(static_cast<const CubicBezier&>(curve));
+    }
+    else {
+        throw GeometryException("Curve type is not recognised");
+    }
+}
+
+void AnyCurve::destroy() {
+    if (m_type == LineSegment::type) {
+        m_lseg.~LineSegment();
+    }
+    else {
+        m_bezier.~CubicBezier();
+    }
+}
+
+AnyCurve::~AnyCurve() {
+    destroy();
+}
+
+
 Path::Path() {}
 
 Path::Path(Path&& cpy)
     : m_curves(std::move(cpy.m_curves)) {}
 
-Path::Path(const Path& cpy) {
-    for (const std::unique_ptr<Curve>& pCurve : cpy.m_curves) {
-        m_curves.push_back(std::unique_ptr<Curve>(pCurve->clone()));
-    }
-}
+Path::Path(const Path& cpy)
+    : m_curves(cpy.m_curves) {}
 
 void Path::append(const Curve& curve) {
-    Curve* cpy = curve.clone();
-
     if (m_curves.size() > 0) {
-        if (curve.initialPoint() != m_curves.back()->finalPoint()) {
-            throw NoncontiguousCurvesException(m_curves.back()->finalPoint(), curve.initialPoint());
+        Point end = m_curves.back()->finalPoint();
+
+        if (curve.initialPoint() != end) {
+            throw NoncontiguousCurvesException(end, curve.initialPoint());
         }
 
-        cpy->setInitialPoint(m_curves.back()->finalPoint());
+        m_curves.push_back(AnyCurve(curve));
+        m_curves.back()->setInitialPoint(end);
+    }
+    else {
+        m_curves.push_back(AnyCurve(curve));
     }
-
-    m_curves.push_back(std::unique_ptr<Curve>(cpy));
 }
 
 bool Path::empty() const {
@@ -525,8 +817,7 @@ Curve& Path::operator[](int idx) {
 // Joins the last point to the first with a line segment
 void Path::close() {
     if (finalPoint() != initialPoint()) {
-        std::unique_ptr<Curve> lseg(new LineSegment(finalPoint(), initialPoint()));
-        m_curves.push_back(std::move(lseg));
+        m_curves.push_back(AnyCurve(LineSegment(finalPoint(), initialPoint())));
     }
 }
 
@@ -559,34 +850,73 @@ Path::~Path() {}
 
 std::ostream& operator<<(std::ostream& out, const Path& path) {
     for (auto i = path.begin(); i != path.end(); ++i) {
-        const std::unique_ptr<Curve>& pCurve = *i;
-        out << *pCurve << std::endl;
+        out << **i << std::endl;
     }
 
     return out;
 }
 
 
+// Forward differencing: after setup, each point costs six additions.
+// In double precision the accumulated error is far below FLOAT_PRECISION for
+// any sensible number of steps, and the final point is set exactly.
+void sampleCubic(const Point& A, const Point& B, const Point& C, const Point& D, int n, Point* out) {
+    double h = 1.0 / static_cast<double>(n);
+    double h2 = h * h;
+    double h3 = h2 * h;
+
+    // Power basis: P(t) = a t^3 + b t^2 + c t + A
+    double ax = D.x - 3.0 * C.x + 3.0 * B.x - A.x;
+    double ay = D.y - 3.0 * C.y + 3.0 * B.y - A.y;
+    double bx = 3.0 * (C.x - 2.0 * B.x + A.x);
+    double by = 3.0 * (C.y - 2.0 * B.y + A.y);
+    double cx = 3.0 * (B.x - A.x);
+    double cy = 3.0 * (B.y - A.y);
+
+    out[0] = A;
+
+    double fx = A.x;
+    double fy = A.y;
+    double dfx = ax * h3 + bx * h2 + cx * h;
+    double dfy = ay * h3 + by * h2 + cy * h;
+    double ddfx = 6.0 * ax * h3 + 2.0 * bx * h2;
+    double ddfy = 6.0 * ay * h3 + 2.0 * by * h2;
+    double dddfx = 6.0 * ax * h3;
+    double dddfy = 6.0 * ay * h3;
+
+    for (int i = 1; i < n; ++i) {
+        fx += dfx;
+        fy += dfy;
+        dfx += ddfx;
+        dfy += ddfy;
+        ddfx += dddfx;
+        ddfy += dddfy;
+
+        out[i] = Point(fx, fy);
+    }
+
+    out[n] = D;
+}
+
+
 // Namespace containing temporary solution due to bug in CGAL4.7. Bezier
 // polygons are approximated by regular polygons.
-#ifdef APPROX_BEZIERS
 namespace approx {
 
 
-static cgal_approx::Polygon toPolygon(const Path& path) {
-    if (!path.isClosed()) {
+static cgal_approx::Polygon toPolygon(const Outline::Contour& contour) {
+    if (!contour.isClosed()) {
         throw GeometryException("Error making polygon; Path is not closed");
     }
 
     cgal_approx::Polygon poly;
 
-    for (auto i = path.begin(); i != path.end(); ++i) {
-        const Curve& curve = **i;
-
-        assert(curve.type() == LineSegment::type);
-        const LineSegment& lseg = dynamic_cast<const LineSegment&>(curve);
+    // Each line segment contributes its initial point
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        assert(contour.verbs[i] == Outline::LINE);
+        const Point& A = contour.points[i];
 
-        poly.push_back(cgal_approx::Point(lseg.A().x, lseg.A().y));
+        poly.push_back(cgal_approx::Point(A.x, A.y));
     }
 
     if (!poly.is_simple()) {
@@ -596,353 +926,1701 @@ static cgal_approx::Polygon toPolygon(const Path& path) {
     return poly;
 }
 
-static double approxCurveLength(const cgal_wrap::BezierCurve& curve) {
-    double dt = 0.1;
-    cgal_wrap::Rational t = 0.0;
-    double sqLen = 0.0;
-
-    cgal_wrap::BezierRatPoint A = curve(t);
-    int n = static_cast<int>(1.0 / dt);
-    for (int i = 1; i <= n; ++i) {
-        t = static_cast<double>(i) * dt;
+static const int LENGTH_SAMPLES = 10;
 
-        cgal_wrap::BezierRatPoint B = curve(t);
+static double approxCurveLength(const Point* ctrl) {
+    Point samples[LENGTH_SAMPLES + 1];
+    sampleCubic(ctrl[0], ctrl[1], ctrl[2], ctrl[3], LENGTH_SAMPLES, samples);
 
-        sqLen += CGAL::to_double(CGAL::squared_distance(A, B));
+    double sqLen = 0.0;
 
-        A = B;
+    for (int i = 1; i <= LENGTH_SAMPLES; ++i) {
+        Point d = samples[i] - samples[i - 1];
+        sqLen += d.x * d.x + d.y * d.y;
     }
 
     return sqrt(sqLen);
 }
 
-static Path toLinearPath(const Path& path) {
-    Path newPath;
-
-    for (auto i = path.begin(); i != path.end(); ++i) {
-        const std::unique_ptr<Curve>& pCurve = *i;
-        const Curve& curve = *pCurve;
-
-        if (curve.type() == CubicBezier::type) {
-            const CubicBezier& bezier = dynamic_cast<const CubicBezier&>(curve);
-
-            std::list<cgal_wrap::BezierRatPoint> points;
-            points.push_back(cgal_wrap::BezierRatPoint(bezier.A()));
-            points.push_back(cgal_wrap::BezierRatPoint(bezier.B()));
-            points.push_back(cgal_wrap::BezierRatPoint(bezier.C()));
-            points.push_back(cgal_wrap::BezierRatPoint(bezier.D()));
+static const int MAX_FLATTENING_DEPTH = 16;
 
-            cgal_wrap::BezierCurve cgalBezier(points.begin(), points.end());
-
-            int n = static_cast<double>(approxCurveLength(cgalBezier) / MIN_LSEG_LENGTH + 0.5);
+static Point midpoint(const Point& A, const Point& B) {
+    return Point(0.5 * (A.x + B.x), 0.5 * (A.y + B.y));
+}
 
-            if (n > MAX_LSEGS_PER_BEZIER) {
-                n = MAX_LSEGS_PER_BEZIER;
-            }
+static double distanceToSegment(const Point& P, const Point& A, const Point& B) {
+    Point AB = B - A;
+    Point AP = P - A;
 
-            if (n < 1) {
-                n = 1;
-            }
+    double lenSq = AB.x * AB.x + AB.y * AB.y;
+    double t = lenSq > 0.0 ? (AP.x * AB.x + AP.y * AB.y) / lenSq : 0.0;
+    t = std::max(0.0, std::min(1.0, t));
 
-            double dt = 1.0 / static_cast<double>(n);
-            cgal_wrap::Rational t = 0.0;
+    double dx = AP.x - t * AB.x;
+    double dy = AP.y - t * AB.y;
 
-            Point A = cgalBezier(t);
-            for (int i = 1; i <= n; ++i) {
-                t = static_cast<double>(i) * dt;
+    return sqrt(dx * dx + dy * dy);
+}
 
-                Point B = cgalBezier(t);
+// Samples the cubic between parameters t0 and t1 to within the tolerance,
+// appending the samples after A and their parameters. The curve lies inside
+// its control hull, so once both inner control points are that close to the
+// chord, the chord will do. Otherwise the curve is split in half, so segments
+// are spent only where the curve actually bends.
+static void subdivideCubic(const Point& A, const Point& B, const Point& C, const Point& D,
+    double t0, double t1, double tolerance, int depth, ArenaVector<Point>& points,
+    ArenaVector<double>& params) {
 
-                LineSegment lseg(A, B);
-                newPath.append(lseg);
+    if (depth >= MAX_FLATTENING_DEPTH
+        || (distanceToSegment(B, A, D) <= tolerance && distanceToSegment(C, A, D) <= tolerance)) {
 
-                A = B;
-            }
-        }
-        else if (curve.type() == LineSegment::type) {
-            newPath.append(curve);
-        }
+        points.push_back(D);
+        params.push_back(t1);
+        return;
     }
 
-    return newPath;
+    Point AB = midpoint(A, B);
+    Point BC = midpoint(B, C);
+    Point CD = midpoint(C, D);
+    Point ABC = midpoint(AB, BC);
+    Point BCD = midpoint(BC, CD);
+    Point M = midpoint(ABC, BCD);
+    double tm = 0.5 * (t0 + t1);
+
+    subdivideCubic(A, AB, ABC, M, t0, tm, tolerance, depth + 1, points, params);
+    subdivideCubic(M, BCD, CD, D, tm, t1, tolerance, depth + 1, points, params);
 }
 
-static Path toPath(const cgal_approx::Polygon& poly) {
-    Path path;
+// Samples the cubic, including both end points, and the parameter of each
+// sample. Either adaptively, if FLATTENING_TOLERANCE is set, or uniformly.
+static void flattenCubic(const Point* ctrl, ArenaVector<Point>& points, ArenaVector<double>& params) {
+    points.push_back(ctrl[0]);
+    params.push_back(0.0);
 
-    auto i = poly.vertices_begin();
-    Point A(CGAL::to_double(i->x()), CGAL::to_double(i->y()));
-    ++i;
+    if (FLATTENING_TOLERANCE > 0.0) {
+        subdivideCubic(ctrl[0], ctrl[1], ctrl[2], ctrl[3], 0.0, 1.0, FLATTENING_TOLERANCE, 0,
+            points, params);
 
-    for (; i != poly.vertices_end(); ++i) {
-        Point B(CGAL::to_double(i->x()), CGAL::to_double(i->y()));
+        return;
+    }
+
+    int n = static_cast<double>(approxCurveLength(ctrl) / MIN_LSEG_LENGTH + 0.5);
 
-        path.append(LineSegment(A, B));
+    if (n > MAX_LSEGS_PER_BEZIER) {
+        n = MAX_LSEGS_PER_BEZIER;
+    }
 
-        A = B;
+    if (n < 1) {
+        n = 1;
     }
 
-    path.close();
+    points.resize(n + 1);
+    sampleCubic(ctrl[0], ctrl[1], ctrl[2], ctrl[3], n, points.data());
 
-    return path;
+    for (int j = 1; j <= n; ++j) {
+        params.push_back(static_cast<double>(j) / n);
+    }
 }
 
-cgal_approx::PolyList toPolyList(const PathList& paths) {
-    class Tree;
-    typedef std::unique_ptr<Tree> pTree_t;
-
-    class Tree {
-        public:
-            Tree() {}
+// A vertex of a flattened contour that was sampled from a cubic
+struct CurveSample {
+    Point P;
+    const Point* ctrl;
+    size_t index;   // Position among the curve's samples
+    double t;
+};
 
-            explicit Tree(const cgal_approx::Polygon& outer_)
-                : outer(outer_) {}
+// Appends the contour with its cubics flattened. If samples isn't null, the
+// vertices sampled from each cubic, end points included, are recorded there.
+static void appendLinearContour(Outline& outline, const Outline::Contour& contour,
+    ArenaVector<CurveSample>* samples) {
 
-            cgal_approx::Polygon outer;
-            std::list<cgal_approx::Polygon> holes;
+    outline.moveTo(contour.initialPoint());
 
-            std::list<pTree_t> children;
+    const Point* A = contour.points;
+    ArenaVector<Point> points;
+    ArenaVector<double> params;
 
-            bool contains(const cgal_approx::Polygon& poly) const {
-                if (!poly.is_empty()) {
-                    return outer.is_empty() || outer.has_on_positive_side(poly.vertex(0));
-                }
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        if (contour.verbs[i] == Outline::CUBIC) {
+            points.clear();
+            params.clear();
+            flattenCubic(A, points, params);
 
-                return false;
+            for (size_t j = 1; j < points.size(); ++j) {
+                outline.lineTo(points[j]);
             }
 
-            bool contains(const Tree& tree) const {
-                return contains(tree.outer);
+            if (samples != nullptr) {
+                for (size_t j = 0; j < points.size(); ++j) {
+                    CurveSample sample = { points[j], A, j, params[j] };
+                    samples->push_back(sample);
+                }
             }
 
-            bool isInside(const Tree& tree) const {
-                return tree.contains(*this);
-            }
+            A += 3;
+        }
+        else {
+            outline.lineTo(A[1]);
+            A += 1;
+        }
+    }
+}
 
-            void insert(pTree_t tree) {
-                assert(this->isInside(*tree) == false);
-                assert(this->contains(*tree));
+static void appendContour(Outline& outline, const cgal_approx::Polygon& poly) {
+    auto i = poly.vertices_begin();
+    outline.moveTo(Point(CGAL::to_double(i->x()), CGAL::to_double(i->y())));
+    ++i;
 
-                for (pTree_t& child : children) {
-                    if (child->contains(*tree)) {
-                        child->insert(std::move(tree));
-                        return;
-                    }
-                }
+    for (; i != poly.vertices_end(); ++i) {
+        outline.lineTo(Point(CGAL::to_double(i->x()), CGAL::to_double(i->y())));
+    }
 
-                // By this point we know that this node's polygon contains the tree's polygon
-                // but none of our children's polygons does. It should thus be added as a child
-                // to this tree, but we must work out which children it should inherit.
+    outline.closePath();
+}
 
-                auto i = children.begin();
-                while (i != children.end()) {
-                    pTree_t& child = *i;
+#ifdef APPROX_BEZIERS
+// Flattens a contour as the engine takes it, simplified if set to
+static Outline flattenContour(const Outline::Contour& contour) {
+    Outline linear;
+    appendLinearContour(linear, contour, nullptr);
 
-                    if (tree->contains(*child)) {
-                        // Our new child tree should inherit this child
+    if (SIMPLIFY_INPUT_TOLERANCE > 0.0) {
+        linear = simplifyInput(linear);
+    }
 
-                        pTree_t tmpChild = std::move(child);
-                        children.erase(i++);
+    return linear;
+}
 
-                        tree->insert(std::move(tmpChild));
-                    }
-                    else {
-                        ++i;
-                    }
-                }
+// Flattens a contour and converts it to a polygon
+static cgal_approx::Polygon toFlatPolygon(const Outline::Contour& contour) {
+    return toPolygon(flattenContour(contour).contour(0));
+}
+#endif
 
-                children.push_back(std::move(tree));
-            }
+template <class Polygon>
+static BoundingBox polygonBox(const Polygon& poly) {
+    BoundingBox box;
 
-            // If the hole has been inserted somewhere, signal this
-            // to the calling function by returning true.
-            bool insertHole(const cgal_approx::Polygon& hole) {
-                if (contains(hole)) {
-                    for (pTree_t& child : children) {
-                        if (child->insertHole(hole)) {
-                            return true;
-                        }
-                    }
+    for (auto i = poly.vertices_begin(); i != poly.vertices_end(); ++i) {
+        box.extend(Point(CGAL::to_double(i->x()), CGAL::to_double(i->y())));
+    }
+
+    return box;
+}
+
+// Counter-clockwise polygons are outer boundaries, and any others are holes
+// of the smallest outer boundary containing their first vertex. Holes inside
+// no outer boundary are dropped.
+//
+// Orientations and sizes come from the areas of the contours the polygons
+// were made from, given in the same order, and only those too small to be
+// sure of are left to the polygon's exact predicates. Outer boundaries are
+// tried smallest first, and only those whose bounding box contains the
+// hole's first vertex need an exact point-in-polygon test, so a glyph with
+// many contours doesn't pay for every pair.
+template <class It>
+static cgal_approx::PolyList nestPolygons(It begin, It end, const ContourArea* contourAreas) {
+    ArenaVector<const cgal_approx::Polygon*> outers;
+    ArenaVector<const cgal_approx::Polygon*> holes;
+    ArenaVector<double> areas;
+
+    for (It i = begin; i != end; ++i, ++contourAreas) {
+        const cgal_approx::Polygon& poly = *i;
+
+        if (poly.is_empty()) {
+            continue;
+        }
+
+        CGAL::Orientation orientation = contourAreas->orientation;
+        double area = contourAreas->area;
+
+        if (orientation == CGAL::COLLINEAR) {
+            orientation = poly.orientation();
+            area = CGAL::to_double(poly.area());
+        }
+
+        if (orientation == CGAL::COUNTERCLOCKWISE) {
+            outers.push_back(&poly);
+            areas.push_back(area);
+        }
+        else {
+            holes.push_back(&poly);
+        }
+    }
+
+    ArenaVector<BoundingBox> boxes;
+    ArenaVector<size_t> bySize(outers.size());
+
+    for (size_t k = 0; k < outers.size(); ++k) {
+        boxes.push_back(polygonBox(*outers[k]));
+        bySize[k] = k;
+    }
+
+    std::stable_sort(bySize.begin(), bySize.end(), [&areas](size_t a, size_t b) {
+        return areas[a] < areas[b];
+    });
+
+    // Holes, as (outer, hole) index pairs
+    ArenaVector<std::pair<size_t, size_t>> owners;
+
+    for (size_t h = 0; h < holes.size(); ++h) {
+        const cgal_approx::Point& P = holes[h]->vertex(0);
+
+        BoundingBox point;
+        point.extend(Point(CGAL::to_double(P.x()), CGAL::to_double(P.y())));
+
+        for (size_t k : bySize) {
+            if (boxes[k].contains(point) && outers[k]->has_on_positive_side(P)) {
+                owners.push_back(std::make_pair(k, h));
+                break;
+            }
+        }
+    }
+
+    std::sort(owners.begin(), owners.end());
+
+    cgal_approx::PolyList polyList;
+    polyList.reserve(outers.size());
+
+    auto owner = owners.begin();
+    ArenaVector<cgal_approx::Polygon> outerHoles;
+
+    for (size_t k = 0; k < outers.size(); ++k) {
+        outerHoles.clear();
+
+        for (; owner != owners.end() && owner->first == k; ++owner) {
+            outerHoles.push_back(*holes[owner->second]);
+        }
+
+        polyList.push_back(cgal_approx::PolygonWithHoles(*outers[k], outerHoles.begin(), outerHoles.end()));
+    }
+
+    return polyList;
+}
+
+cgal_approx::PolyList toPolyList(const Outline& outline) {
+    ArenaVector<cgal_approx::Polygon> polygons;
+    ArenaVector<ContourArea> areas;
+
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        Outline::Contour contour = outline.contour(i);
+
+        if (!contour.empty()) {
+            polygons.push_back(toPolygon(contour));
+            areas.push_back(contourArea(contour));
+        }
+    }
+
+    return nestPolygons(polygons.begin(), polygons.end(), areas.data());
+}
+
+cgal_approx::PolyList toPolyList(const PathList& paths) {
+    return approx::toPolyList(geometry::toOutline(paths));
+}
+
+Outline toLinearOutline(const Outline& outline) {
+    Outline linear;
+    linear.reserve(outline.verbs().size(), outline.points().size());
+
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        appendLinearContour(linear, outline.contour(i), nullptr);
+    }
+
+    return linear;
+}
+
+PathList toLinearPaths(const PathList& paths) {
+    return geometry::toPathList(toLinearOutline(geometry::toOutline(paths)));
+}
+
+Outline toOutline(const cgal_approx::PolyList& polyList) {
+    Outline outline;
+
+    for (auto i = polyList.begin(); i != polyList.end(); ++i) {
+        const cgal_approx::PolygonWithHoles& poly = *i;
+        const cgal_approx::Polygon& outer = poly.outer_boundary();
+
+        appendContour(outline, outer);
+
+        for (auto j = poly.holes_begin(); j != poly.holes_end(); ++j) {
+            appendContour(outline, *j);
+        }
+    }
+
+    return outline;
+}
+
+PathList toPathList(const cgal_approx::PolyList& polyList) {
+    return geometry::toPathList(toOutline(polyList));
+}
+
+
+bool RESTORE_CURVES = false;
+
+
+static bool lessPoint(const CurveSample& a, const CurveSample& b) {
+    return a.P.x < b.P.x || (a.P.x == b.P.x && a.P.y < b.P.y);
+}
+
+// An edge of a linear contour joining two samples of one curve
+struct CurveEdge {
+    const Point* ctrl;  // Null if the edge isn't part of any curve
+    double t0;
+    double t1;
+};
+
+// Whether the edge PQ joins two samples of the same curve. Any samples
+// between them can only be missing because simplification removed them.
+// Where a point was sampled more than once, as the ends of a closed curve
+// are, the nearest pair along the curve is taken.
+static bool edgeAlong(const ArenaVector<CurveSample>& samples, const Point& P, const Point& Q,
+    CurveEdge& edge) {
+
+    CurveSample keyP = { P, nullptr, 0, 0.0 };
+    CurveSample keyQ = { Q, nullptr, 0, 0.0 };
+
+    auto rangeP = std::equal_range(samples.begin(), samples.end(), keyP, lessPoint);
+    auto rangeQ = std::equal_range(samples.begin(), samples.end(), keyQ, lessPoint);
+
+    size_t bestGap = 0;
+
+    for (auto a = rangeP.first; a != rangeP.second; ++a) {
+        for (auto b = rangeQ.first; b != rangeQ.second; ++b) {
+            size_t gap = a->index > b->index ? a->index - b->index : b->index - a->index;
+
+            if (a->ctrl == b->ctrl && gap > 0 && (bestGap == 0 || gap < bestGap)) {
+                edge.ctrl = a->ctrl;
+                edge.t0 = a->t;
+                edge.t1 = b->t;
+                bestGap = gap;
+            }
+        }
+    }
+
+    return bestGap > 0;
+}
+
+// Whether edge f carries on along the same curve, in the same direction, as e
+static bool continues(const CurveEdge& e, const CurveEdge& f) {
+    return e.ctrl != nullptr && f.ctrl == e.ctrl && f.t0 == e.t1 && (e.t0 < e.t1) == (f.t0 < f.t1);
+}
+
+// Vertices the engine passed through untouched keep their coordinates
+// exactly, so they are matched to the samples they came from by value.
+// Vertices made at intersections match nothing, and break the runs.
+Outline restoreCurves(const Outline& linear, const Outline& source) {
+    ArenaVector<CurveSample> samples;
+    Outline flattened;
+
+    for (size_t i = 0; i < source.numContours(); ++i) {
+        appendLinearContour(flattened, source.contour(i), &samples);
+    }
+
+    std::sort(samples.begin(), samples.end(), lessPoint);
+
+    Outline result;
+    ArenaVector<CurveEdge> edges;
+
+    for (size_t i = 0; i < linear.numContours(); ++i) {
+        Outline::Contour contour = linear.contour(i);
+        const Point* V = contour.points;
+        size_t m = contour.numPoints;
+
+        if (m > 1 && V[m - 1].x == V[0].x && V[m - 1].y == V[0].y) {
+            --m;
+        }
+
+        if (m < 2) {
+            result.append(contour);
+            continue;
+        }
+
+        edges.clear();
+
+        for (size_t j = 0; j < m; ++j) {
+            CurveEdge edge = { nullptr, 0.0, 0.0 };
+            edgeAlong(samples, V[j], V[(j + 1) % m], edge);
+
+            edges.push_back(edge);
+        }
+
+        // Start where a run begins, so that none wraps around the end
+        size_t start = 0;
+
+        for (size_t j = 0; j < m; ++j) {
+            if (!continues(edges[(j + m - 1) % m], edges[j])) {
+                start = j;
+                break;
+            }
+        }
+
+        result.moveTo(V[start]);
+
+        for (size_t k = 0; k < m;) {
+            const CurveEdge& first = edges[(start + k) % m];
+
+            if (first.ctrl == nullptr) {
+                result.lineTo(V[(start + k + 1) % m]);
+                ++k;
+                continue;
+            }
+
+            size_t len = 1;
+
+            while (k + len < m && continues(edges[(start + k + len - 1) % m], edges[(start + k + len) % m])) {
+                ++len;
+            }
+
+            const CurveEdge& last = edges[(start + k + len - 1) % m];
+
+            Point piece[4];
+            subCubic(first.ctrl, std::min(first.t0, last.t1), std::max(first.t0, last.t1), piece);
+
+            if (first.t0 > last.t1) {
+                std::swap(piece[0], piece[3]);
+                std::swap(piece[1], piece[2]);
+            }
+
+            // The ends are the vertices themselves, which the neighbouring
+            // edges share
+            result.curveTo(piece[1], piece[2], V[(start + k + len) % m]);
+            k += len;
+        }
+    }
+
+    return result;
+}
+
+bool USE_FAST_KERNEL = false;
+
+// Output coordinates end up as 16.16 fixed-point charstring operands
+static const double SNAP_GRID = 1.0 / 65536.0;
+
+// Largest permitted disagreement between the union's area and the bounds
+// implied by its operands, relative to their total area
+static const double AREA_TOLERANCE = 1e-6;
+
+static double snap(double v) {
+    return std::round(v / SNAP_GRID) * SNAP_GRID;
+}
+
+static cgal_approx::FastPolygon toFastPolygon(const cgal_approx::Polygon& poly) {
+    cgal_approx::FastPolygon fast;
+
+    for (auto i = poly.vertices_begin(); i != poly.vertices_end(); ++i) {
+        fast.push_back(cgal_approx::FastPoint(CGAL::to_double(i->x()), CGAL::to_double(i->y())));
+    }
+
+    return fast;
+}
+
+static cgal_approx::FastPolygonWithHoles toFastPolygon(const cgal_approx::PolygonWithHoles& poly) {
+    cgal_approx::FastPolygonWithHoles fast(toFastPolygon(poly.outer_boundary()));
+
+    for (auto i = poly.holes_begin(); i != poly.holes_end(); ++i) {
+        fast.add_hole(toFastPolygon(*i));
+    }
+
+    return fast;
+}
+
+// Area of the polygon less that of its holes
+static double netArea(const cgal_approx::PolygonWithHoles& poly) {
+    double area = CGAL::to_double(poly.outer_boundary().area());
+
+    for (auto i = poly.holes_begin(); i != poly.holes_end(); ++i) {
+        area -= fabs(CGAL::to_double(i->area()));
+    }
+
+    return area;
+}
+
+// Snaps the boundary's vertices to the grid, dropping any that collapse onto
+// their predecessor. Returns false if the snapped boundary is degenerate,
+// self-intersecting, or not of the expected orientation.
+static bool snapBoundary(const cgal_approx::FastPolygon& poly, CGAL::Orientation orientation,
+    cgal_approx::FastPolygon& snapped) {
+
+    ArenaVector<cgal_approx::FastPoint> points;
+
+    for (auto i = poly.vertices_begin(); i != poly.vertices_end(); ++i) {
+        cgal_approx::FastPoint P(snap(i->x()), snap(i->y()));
+
+        if (points.empty() || P != points.back()) {
+            points.push_back(P);
+        }
+    }
+
+    while (points.size() > 1 && points.front() == points.back()) {
+        points.pop_back();
+    }
+
+    snapped = cgal_approx::FastPolygon(points.begin(), points.end());
+
+    return snapped.size() >= 3 && snapped.is_simple() && snapped.orientation() == orientation;
+}
+
+struct FastEdge {
+    cgal_approx::FastPoint P;
+    cgal_approx::FastPoint Q;
+    BoundingBox box;
+};
+
+// Whether the edges cross, or overlap along a stretch. Meeting at a point
+// that is an end of either is allowed.
+static bool edgesCross(const FastEdge& a, const FastEdge& b) {
+    int o1 = CGAL::orientation(a.P, a.Q, b.P);
+    int o2 = CGAL::orientation(a.P, a.Q, b.Q);
+
+    if (o1 == CGAL::COLLINEAR && o2 == CGAL::COLLINEAR) {
+        // Along one line, so compare their spans in one coordinate
+        bool byX = a.P.x() != a.Q.x();
+
+        double aMin = byX ? std::min(a.P.x(), a.Q.x()) : std::min(a.P.y(), a.Q.y());
+        double aMax = byX ? std::max(a.P.x(), a.Q.x()) : std::max(a.P.y(), a.Q.y());
+        double bMin = byX ? std::min(b.P.x(), b.Q.x()) : std::min(b.P.y(), b.Q.y());
+        double bMax = byX ? std::max(b.P.x(), b.Q.x()) : std::max(b.P.y(), b.Q.y());
+
+        return std::min(aMax, bMax) > std::max(aMin, bMin);
+    }
+
+    int o3 = CGAL::orientation(b.P, b.Q, a.P);
+    int o4 = CGAL::orientation(b.P, b.Q, a.Q);
+
+    return o1 * o2 < 0 && o3 * o4 < 0;
+}
+
+// Whether any two edges of the polygons' boundaries cross. The snapped
+// vertices are exact doubles and the predicates are exact, so this is too.
+static bool anyEdgesCross(const cgal_approx::FastPolyList& polyList) {
+    ArenaVector<FastEdge> edges;
+
+    auto addEdges = [&edges](const cgal_approx::FastPolygon& poly) {
+        for (size_t i = 0; i < poly.size(); ++i) {
+            FastEdge edge = { poly[i], poly[(i + 1) % poly.size()], BoundingBox() };
+            edge.box.extend(Point(edge.P.x(), edge.P.y()));
+            edge.box.extend(Point(edge.Q.x(), edge.Q.y()));
+            edges.push_back(edge);
+        }
+    };
+
+    for (auto& i : polyList) {
+        addEdges(i.outer_boundary());
+
+        for (auto j = i.holes_begin(); j != i.holes_end(); ++j) {
+            addEdges(*j);
+        }
+    }
+
+    std::sort(edges.begin(), edges.end(), [](const FastEdge& a, const FastEdge& b) {
+        return a.box.xmin < b.box.xmin;
+    });
+
+    for (size_t i = 0; i < edges.size(); ++i) {
+        for (size_t j = i + 1; j < edges.size() && edges[j].box.xmin <= edges[i].box.xmax; ++j) {
+            if (edges[i].box.overlaps(edges[j].box) && edgesCross(edges[i], edges[j])) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Where the other boundary lies with respect to the polygon, judged by its
+// first vertex not on the polygon's boundary. With no edges crossing, that
+// vertex's side is the side of the whole boundary. ON_BOUNDARY if every
+// vertex is on it.
+static CGAL::Bounded_side sideOf(const cgal_approx::FastPolygon& poly, const cgal_approx::FastPolygon& other) {
+    for (auto i = other.vertices_begin(); i != other.vertices_end(); ++i) {
+        CGAL::Bounded_side side = poly.bounded_side(*i);
+
+        if (side != CGAL::ON_BOUNDARY) {
+            return side;
+        }
+    }
+
+    return CGAL::ON_BOUNDARY;
+}
+
+// Whether the outer boundary lies in the filled region of the polygon
+static bool insideFilledRegion(const cgal_approx::FastPolygonWithHoles& poly,
+    const cgal_approx::FastPolygon& outer) {
+
+    if (sideOf(poly.outer_boundary(), outer) != CGAL::ON_BOUNDED_SIDE) {
+        return false;
+    }
+
+    for (auto i = poly.holes_begin(); i != poly.holes_end(); ++i) {
+        if (sideOf(*i, outer) != CGAL::ON_UNBOUNDED_SIDE) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Whether the snapped polygons form a valid union: no two boundaries cross,
+// each hole lies inside its outer boundary and outside the other holes, and
+// no polygon lies in another's filled region. Each boundary on its own has
+// already been checked by snapBoundary.
+static bool isValidUnion(const cgal_approx::FastPolyList& polyList) {
+    if (anyEdgesCross(polyList)) {
+        return false;
+    }
+
+    ArenaVector<BoundingBox> boxes;
+
+    for (auto& i : polyList) {
+        const cgal_approx::FastPolygon& outer = i.outer_boundary();
+
+        for (auto j = i.holes_begin(); j != i.holes_end(); ++j) {
+            if (sideOf(outer, *j) != CGAL::ON_BOUNDED_SIDE) {
+                return false;
+            }
+
+            for (auto k = i.holes_begin(); k != j; ++k) {
+                if (sideOf(*j, *k) != CGAL::ON_UNBOUNDED_SIDE || sideOf(*k, *j) != CGAL::ON_UNBOUNDED_SIDE) {
+                    return false;
+                }
+            }
+        }
+
+        boxes.push_back(polygonBox(outer));
+    }
+
+    for (size_t i = 0; i < polyList.size(); ++i) {
+        for (size_t j = 0; j < polyList.size(); ++j) {
+            if (i != j && boxes[i].overlaps(boxes[j])
+                && (sideOf(polyList[i].outer_boundary(), polyList[j].outer_boundary()) == CGAL::ON_BOUNDARY
+                    || insideFilledRegion(polyList[i], polyList[j].outer_boundary()))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void appendBoundary(Outline& outline, const cgal_approx::FastPolygon& poly) {
+    auto i = poly.vertices_begin();
+    outline.moveTo(Point(i->x(), i->y()));
+    ++i;
+
+    for (; i != poly.vertices_end(); ++i) {
+        outline.lineTo(Point(i->x(), i->y()));
+    }
+
+    outline.closePath();
+}
+
+bool fastJoin(const cgal_approx::PolyList& polyList1, const cgal_approx::PolyList& polyList2,
+    Outline& result) {
+
+    cgal_approx::FastPolyList polyList;
+
+    try {
+        cgal_approx::FastPolyList fast;
+        fast.reserve(polyList1.size() + polyList2.size());
+
+        for (auto& i : polyList1) {
+            fast.push_back(toFastPolygon(i));
+        }
+
+        for (auto& i : polyList2) {
+            fast.push_back(toFastPolygon(i));
+        }
+
+        cgal_approx::FastPolygonSet polySet;
+        polySet.join(fast.begin(), fast.end());
+        polySet.polygons_with_holes(std::back_inserter(polyList));
+    }
+    catch (const std::exception&) {
+        // CgalException once initialised, and CGAL's own failure exceptions
+        // otherwise; either way the exact kernel gets its turn
+        return false;
+    }
+
+    // The union covers each of its operands and nothing beyond all of them
+    double maxArea = 0.0;
+    double sumArea = 0.0;
+
+    for (const cgal_approx::PolyList* operand : { &polyList1, &polyList2 }) {
+        for (auto& i : *operand) {
+            double area = netArea(i);
+
+            maxArea = std::max(maxArea, area);
+            sumArea += area;
+        }
+    }
+
+    cgal_approx::FastPolyList snappedList;
+    double area = 0.0;
+
+    for (auto& i : polyList) {
+        cgal_approx::FastPolygon outer;
+
+        if (!snapBoundary(i.outer_boundary(), CGAL::COUNTERCLOCKWISE, outer)) {
+            return false;
+        }
+
+        cgal_approx::FastPolygonWithHoles snapped(outer);
+        area += outer.area();
+
+        for (auto j = i.holes_begin(); j != i.holes_end(); ++j) {
+            cgal_approx::FastPolygon hole;
+
+            if (!snapBoundary(*j, CGAL::CLOCKWISE, hole)) {
+                return false;
+            }
+
+            snapped.add_hole(hole);
+            area += hole.area();
+        }
+
+        snappedList.push_back(snapped);
+    }
+
+    double tolerance = AREA_TOLERANCE * sumArea;
+
+    if (area < maxArea - tolerance || area > sumArea + tolerance) {
+        return false;
+    }
+
+    if (!isValidUnion(snappedList)) {
+        return false;
+    }
+
+    Outline outline;
+
+    for (auto& i : snappedList) {
+        appendBoundary(outline, i.outer_boundary());
+
+        for (auto j = i.holes_begin(); j != i.holes_end(); ++j) {
+            appendBoundary(outline, *j);
+        }
+    }
+
+    result = std::move(outline);
+    return true;
+}
+
+// Joins the polygons with the exact kernel alone
+static Outline exactJoin(const cgal_approx::PolyList& polyList1, const cgal_approx::PolyList& polyList2) {
+    // One aggregated join sweeps everything at once, where joining the
+    // polygons one by one would re-overlay the growing result each time
+    cgal_approx::PolyList all(polyList1);
+    all.insert(all.end(), polyList2.begin(), polyList2.end());
+
+    cgal_approx::PolygonSet polySet;
+    polySet.join(all.begin(), all.end());
+
+    cgal_approx::PolyList polyList;
+    polySet.polygons_with_holes(std::back_inserter(polyList));
+
+    return toOutline(polyList);
+}
+
+Outline joinPolyLists(const cgal_approx::PolyList& polyList1, const cgal_approx::PolyList& polyList2) {
+    Outline result;
+
+    if (USE_FAST_KERNEL && fastJoin(polyList1, polyList2, result)) {
+        return result;
+    }
+
+    return exactJoin(polyList1, polyList2);
+}
+
+Outline computeUnion(const Outline& outline1, const Outline& outline2) {
+    Outline linear1 = toLinearOutline(outline1);
+    Outline linear2 = toLinearOutline(outline2);
+
+    if (SIMPLIFY_INPUT_TOLERANCE > 0.0) {
+        linear1 = simplifyInput(linear1);
+        linear2 = simplifyInput(linear2);
+    }
+
+    Outline joined;
+
+    // The native clipper takes the flattened outlines as they are, so
+    // polygons are only built if it fails
+    if (!USE_NATIVE_CLIPPER || !nativeUnion(linear1, linear2, joined)) {
+        joined = approx::joinPolyLists(approx::toPolyList(linear1), approx::toPolyList(linear2));
+    }
+
+    if (RESTORE_CURVES) {
+        Outline source(outline1);
+        source.append(outline2);
+
+        joined = restoreCurves(joined, source);
+    }
+
+    if (SIMPLIFY_OUTPUT_TOLERANCE > 0.0) {
+        joined = simplifyOutput(joined);
+    }
+
+    if (CURVE_FIT_TOLERANCE > 0.0) {
+        joined = fitCurves(joined, CURVE_FIT_TOLERANCE);
+    }
+
+    return joined;
+}
+
+PathList computeUnion(const PathList& paths1, const PathList& paths2) {
+    return geometry::toPathList(approx::computeUnion(geometry::toOutline(paths1), geometry::toOutline(paths2)));
+}
+
+
+}
+
+
+#ifdef APPROX_BEZIERS
+typedef approx::cgal_approx::PolyList EnginePolyList;
+#else
+typedef cgal_wrap::PolyList EnginePolyList;
+typedef cgal_wrap::BezierPolygonSet EnginePolygonSet;
+#endif
+
+
+// Converts contours to the boolean engine's polygons
+class EngineConverter {
+    public:
+#ifdef APPROX_BEZIERS
+        PreparedOperand::Polygon operator()(const Outline::Contour& contour) {
+            return approx::toFlatPolygon(contour);
+        }
+#else
+        EngineConverter()
+            : m_fnMakeXMonotone(m_traits.make_x_monotone_2_object()) {}
+
+        PreparedOperand::Polygon operator()(const Outline::Contour& contour) {
+            if (SIMPLIFY_INPUT_TOLERANCE > 0.0) {
+                Outline outline;
+                outline.append(contour);
+
+                Outline simplified = simplifyInput(outline);
+
+                return toBezierPolygon(simplified.contour(0), m_fnMakeXMonotone);
+            }
+
+            return toBezierPolygon(contour, m_fnMakeXMonotone);
+        }
+
+    private:
+        cgal_wrap::Traits m_traits;
+        cgal_wrap::Traits::Make_x_monotone_2 m_fnMakeXMonotone;
+#endif
+};
+
+template <class It>
+static EnginePolyList toEnginePolyList(It begin, It end, const ContourArea* areas) {
+#ifdef APPROX_BEZIERS
+    return approx::nestPolygons(begin, end, areas);
+#else
+    return assemblePolyList<cgal_wrap::BezierPolygon, cgal_wrap::BezierPolygonWithHoles>(begin, end, areas);
+#endif
+}
+
+static Outline joinPolyLists(const EnginePolyList& polyList1, const EnginePolyList& polyList2) {
+#ifdef APPROX_BEZIERS
+    return approx::joinPolyLists(polyList1, polyList2);
+#else
+    EnginePolyList all(polyList1);
+    all.insert(all.end(), polyList2.begin(), polyList2.end());
+
+    // Aggregated, rather than joining the polygons one at a time
+    EnginePolygonSet polySet;
+    polySet.join(all.begin(), all.end());
+
+    EnginePolyList polyList;
+    polySet.polygons_with_holes(std::back_inserter(polyList));
+
+    return toOutline(polyList);
+#endif
+}
+
+
+PreparedOperand::PreparedOperand(const Outline& outline)
+    : m_outline(outline) {
+
+    EngineConverter convert;
+
+    for (size_t i = 0; i < m_outline.numContours(); ++i) {
+        Outline::Contour contour = m_outline.contour(i);
+        BoundingBox box = contour.bbox();
+
+        m_contourBoxes.push_back(box);
+        m_bbox.extend(box);
+        m_polygons.push_back(contour.empty() ? Polygon() : convert(contour));
+    }
+}
+
+const Outline& PreparedOperand::outline() const {
+    return m_outline;
+}
+
+const BoundingBox& PreparedOperand::bbox() const {
+    return m_bbox;
+}
+
+const std::vector<BoundingBox>& PreparedOperand::contourBoxes() const {
+    return m_contourBoxes;
+}
+
+const std::vector<PreparedOperand::Polygon>& PreparedOperand::polygons() const {
+    return m_polygons;
+}
+
+
+static size_t findRoot(ArenaVector<size_t>& parent, size_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+// Bounding boxes of the control hull of each segment of the contour
+static void segmentBoxes(const Outline::Contour& contour, ArenaVector<BoundingBox>& boxes) {
+    const Point* A = contour.points;
+
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        size_t n = contour.verbs[i] == Outline::LINE ? 1 : 3;
+
+        BoundingBox box;
+        for (size_t j = 0; j <= n; ++j) {
+            box.extend(A[j]);
+        }
+
+        boxes.push_back(box);
+        A += n;
+    }
+}
+
+static bool anyOverlap(const ArenaVector<BoundingBox>& boxes1, const ArenaVector<BoundingBox>& boxes2) {
+    for (const BoundingBox& a : boxes1) {
+        for (const BoundingBox& b : boxes2) {
+            if (a.overlaps(b)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// The winding number of P about the contour's control polygon. If P lies
+// outside the control hull of every segment, this equals the winding number
+// about the contour itself.
+static int controlPolygonWinding(const Outline::Contour& contour, const Point& P) {
+    int winding = 0;
+
+    for (size_t i = 0; i < contour.numPoints; ++i) {
+        const Point& A = contour.points[i];
+        const Point& B = contour.points[(i + 1) % contour.numPoints];
+
+        double cross = (B.x - A.x) * (P.y - A.y) - (P.x - A.x) * (B.y - A.y);
+
+        if (A.y <= P.y) {
+            if (B.y > P.y && cross > 0) {
+                ++winding;
+            }
+        }
+        else if (B.y <= P.y && cross < 0) {
+            --winding;
+        }
+    }
+
+    return winding;
+}
+
+// The contours of both outlines, indexed together, with the data needed to
+// partition them for the union. The second outline may have been prepared.
+class UnionInput {
+    public:
+        UnionInput(const Outline& outline1, const Outline& outline2, const PreparedOperand* prepared2)
+            : outline1(outline1), outline2(outline2), m_n1(outline1.numContours()), m_prepared2(prepared2) {
+
+            size_t n = m_n1 + outline2.numContours();
 
-                    // Only if the hole was NOT inserted into any of the children
-                    // do we insert the hole
-                    holes.push_back(hole);
+            for (size_t i = 0; i < n; ++i) {
+                contours.push_back(i < m_n1 ? outline1.contour(i) : outline2.contour(i - m_n1));
 
-                    return true;
+                if (i >= m_n1 && m_prepared2 != nullptr) {
+                    boxes.push_back(m_prepared2->contourBoxes()[i - m_n1]);
                 }
                 else {
+                    boxes.push_back(contours[i].bbox());
+                }
+            }
+
+            m_segBoxes.resize(n);
+        }
+
+        size_t size() const {
+            return contours.size();
+        }
+
+        int operand(size_t i) const {
+            return i < m_n1 ? 0 : 1;
+        }
+
+        // A contour is dominated if it lies inside the filled region of the
+        // other operand and none of that operand's contours lie inside it.
+        // Removing it then leaves the union unchanged. Both tests are exact
+        // once segment hulls are known to be disjoint.
+        bool isDominated(size_t i, const ArenaVector<size_t>& others) {
+            const Outline::Contour& contour = contours[i];
+            int winding = 0;
+
+            for (size_t j : others) {
+                if (!boxes[i].overlaps(boxes[j])) {
+                    continue;
+                }
+
+                if (anyOverlap(segmentBoxesOf(i), segmentBoxesOf(j))) {
+                    return false;
+                }
+
+                if (controlPolygonWinding(contour, contours[j].initialPoint()) != 0) {
                     return false;
                 }
+
+                winding += controlPolygonWinding(contours[j], contour.initialPoint());
             }
 
-            // Don't hang on to these raw pointers
-            std::list<const Tree*> toList() const {
-                std::list<const Tree*> list;
-                toList_r(list);
+            return winding != 0;
+        }
 
-                return list;
+        // The engine polygon for the contour, if it was prepared in advance
+        const PreparedOperand::Polygon* preparedPolygon(size_t i) const {
+            if (i >= m_n1 && m_prepared2 != nullptr) {
+                return &m_prepared2->polygons()[i - m_n1];
             }
 
-#ifdef DEBUG
-            void dbg_print(std::ostream& out) const {
-                out << "Tree (children: " << children.size() << ")" << std::endl;
-                dbg_print_r(out, 0);
+            return nullptr;
+        }
+
+        const Outline& outline1;
+        const Outline& outline2;
+        ArenaVector<Outline::Contour> contours;
+        ArenaVector<BoundingBox> boxes;
+
+    private:
+        const ArenaVector<BoundingBox>& segmentBoxesOf(size_t i) {
+            if (m_segBoxes[i].empty()) {
+                segmentBoxes(contours[i], m_segBoxes[i]);
             }
-#endif
 
-        private:
-#ifdef DEBUG
-            void dbg_print_r(std::ostream& out, int depth) const {
-                dbg_print_tabs(out, depth);
-                out << "Node (depth: " << depth << ", children: " << children.size()
-                    << ", holes: " << holes.size() << ")" << std::endl;
+            return m_segBoxes[i];
+        }
 
-                dbg_print_tabs(out, depth + 1);
-                out << "Outer poly: " << outer << std::endl;
+        size_t m_n1;
+        const PreparedOperand* m_prepared2;
+        ArenaVector<ArenaVector<BoundingBox>> m_segBoxes;
+};
 
-                for (const cgal_approx::Polygon& hole : holes) {
-                    dbg_print_tabs(out, depth + 2);
-                    out << "Hole: " << hole << std::endl;
-                }
+// Partitions the contours into groups that overlap, directly or through
+// other contours, and returns the group root of each. Holes always land in
+// the same group as the contour around them.
+static ArenaVector<size_t> groupContours(const UnionInput& input) {
+    size_t n = input.size();
+    const ArenaVector<BoundingBox>& boxes = input.boxes;
 
-                for (const pTree_t& child : children) {
-                    child->dbg_print_r(out, depth + 1);
-                }
+    ArenaVector<size_t> order(n);
+    ArenaVector<size_t> parent(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+        parent[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&boxes](size_t a, size_t b) {
+        return boxes[a].xmin < boxes[b].xmin;
+    });
+
+    for (size_t i = 0; i < n; ++i) {
+        const BoundingBox& a = boxes[order[i]];
+
+        for (size_t j = i + 1; j < n; ++j) {
+            const BoundingBox& b = boxes[order[j]];
+
+            if (b.xmin > a.xmax + FLOAT_PRECISION) {
+                break;
+            }
+
+            if (a.overlaps(b)) {
+                parent[findRoot(parent, order[i])] = findRoot(parent, order[j]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        parent[i] = findRoot(parent, i);
+    }
+
+    return parent;
+}
+
+// Marks the contours of one mixed group that can be removed without changing
+// the union. A contour is only removed along with everything that may be
+// nested inside it, so an outer boundary never loses its holes' context.
+static void dropDominated(UnionInput& input, const ArenaVector<size_t>& group,
+    ArenaVector<uint8_t>& dropped) {
+
+    ArenaVector<size_t> members[2];
+
+    for (size_t i : group) {
+        members[input.operand(i)].push_back(i);
+    }
+
+    ArenaVector<uint8_t> dominated(input.size(), 0);
+
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i : members[k]) {
+            dominated[i] = input.isDominated(i, members[1 - k]);
+        }
+    }
+
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i : members[k]) {
+            if (!dominated[i]) {
+                continue;
             }
 
-            void dbg_print_tabs(std::ostream& out, int n) const {
-                for (int i = 0; i < n; ++i) {
-                    out << "\t";
+            bool nestedDominated = true;
+
+            for (size_t j : members[k]) {
+                if (j != i && input.boxes[i].contains(input.boxes[j]) && !dominated[j]) {
+                    nestedDominated = false;
+                    break;
                 }
             }
-#endif
 
-            void toList_r(std::list<const Tree*>& list) const {
-                list.push_back(this);
+            dropped[i] = nestedDominated;
+        }
+    }
+}
+
+#ifndef APPROX_BEZIERS
+// An edge of the contours given to the exact polygon kernel
+struct ChordEdge {
+    const Point* ctrl;  // The cubic's control points, or null for a line
+    BoundingBox box;    // The bounds of its control points
+};
+
+// A cubic the exact polygon kernel sees as the line segment between its ends
+struct Chord {
+    Point A;
+    Point B;
+    const Point* ctrl;
+    bool reversed;      // Whether A is the cubic's final point
+};
+
+static bool lessChord(const Chord& a, const Chord& b) {
+    if (a.A.x != b.A.x) {
+        return a.A.x < b.A.x;
+    }
+
+    if (a.A.y != b.A.y) {
+        return a.A.y < b.A.y;
+    }
+
+    return a.B.x < b.B.x || (a.B.x == b.B.x && a.B.y < b.B.y);
+}
+
+static bool isMonotone(double a, double b, double c, double d) {
+    return (a <= b && b <= c && c <= d) || (a >= b && b >= c && c >= d);
+}
+
+// Whether the cubic's control points run monotonically in both coordinates,
+// between ends that differ in both. The ends are then opposite corners of
+// its control box, and they are the only points at which the cubic, or its
+// chord, meets the box's sides.
+static bool isChordable(const Point* ctrl) {
+    return ctrl[0].x != ctrl[3].x && ctrl[0].y != ctrl[3].y
+        && isMonotone(ctrl[0].x, ctrl[1].x, ctrl[2].x, ctrl[3].x)
+        && isMonotone(ctrl[0].y, ctrl[1].y, ctrl[2].y, ctrl[3].y);
+}
+
+// Whether the box reaches into the interior of the cubic's control box
+static bool entersBox(const BoundingBox& box, const BoundingBox& curveBox) {
+    return box.xmax > curveBox.xmin && box.xmin < curveBox.xmax
+        && box.ymax > curveBox.ymin && box.ymin < curveBox.ymax;
+}
+
+// Whether every cubic of the contours can be swapped for its chord without
+// changing the union, other than by that same swap. The region between a
+// cubic and its chord lies in the cubic's control box, and meets the box's
+// sides only at the cubic's ends; if no other edge reaches into the box,
+// then no other edge reaches into the region, which is either wholly inside
+// or wholly outside the rest of the union. The chord is then on the union's
+// boundary exactly when the cubic is.
+static bool allChordable(const ArenaVector<Outline::Contour>& contours) {
+    ArenaVector<ChordEdge> edges;
+    bool anyCubic = false;
+
+    for (const Outline::Contour& contour : contours) {
+        const Point* A = contour.points;
 
-                for (const pTree_t& child : children) {
-                    child->toList_r(list);
+        for (size_t i = 0; i < contour.numVerbs; ++i) {
+            ChordEdge edge = { nullptr, BoundingBox() };
+            edge.box.extend(A[0]);
+            edge.box.extend(A[1]);
+
+            if (contour.verbs[i] == Outline::CUBIC) {
+                if (!isChordable(A)) {
+                    return false;
                 }
+
+                anyCubic = true;
+                edge.ctrl = A;
+                edge.box.extend(A[2]);
+                edge.box.extend(A[3]);
+                A += 3;
+            }
+            else {
+                A += 1;
             }
-    };
 
-    Tree polyTree;
-    cgal_approx::PolyList polyList;
+            edges.push_back(edge);
+        }
+    }
+
+    if (!anyCubic) {
+        return true;
+    }
 
-    std::list<cgal_approx::Polygon> holes;
+    std::sort(edges.begin(), edges.end(), [](const ChordEdge& a, const ChordEdge& b) {
+        return a.box.xmin < b.box.xmin;
+    });
 
-    for (const Path& path : paths) {
-        if (path.empty()) {
-            continue;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        for (size_t j = i + 1; j < edges.size() && edges[j].box.xmin < edges[i].box.xmax; ++j) {
+            if ((edges[i].ctrl != nullptr && entersBox(edges[j].box, edges[i].box))
+                || (edges[j].ctrl != nullptr && entersBox(edges[i].box, edges[j].box))) {
+                return false;
+            }
         }
+    }
+
+    return true;
+}
+
+// Appends the contour with each cubic replaced by its chord
+static void appendChords(Outline& outline, const Outline::Contour& contour, ArenaVector<Chord>& chords) {
+    outline.moveTo(contour.initialPoint());
 
-        cgal_approx::Polygon subPoly = toPolygon(path);
+    const Point* A = contour.points;
 
-        if (subPoly.orientation() == CGAL::COUNTERCLOCKWISE) {
-            polyTree.insert(pTree_t(new Tree(subPoly)));
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        if (contour.verbs[i] == Outline::CUBIC) {
+            Chord forward = { A[0], A[3], A, false };
+            Chord backward = { A[3], A[0], A, true };
+            chords.push_back(forward);
+            chords.push_back(backward);
+
+            outline.lineTo(A[3]);
+            A += 3;
         }
         else {
-            holes.push_back(subPoly);
+            outline.lineTo(A[1]);
+            A += 1;
         }
     }
+}
 
-    for (const cgal_approx::Polygon& hole : holes) {
-        polyTree.insertHole(hole);
+// Gives each edge of the joined outline that is one of the chords, in
+// either direction, back as its cubic. The chords' ends are input vertices,
+// which the exact kernel returns exactly.
+static Outline restoreChords(const Outline& joined, ArenaVector<Chord>& chords) {
+    if (chords.empty()) {
+        return joined;
     }
 
-#ifdef DEBUG
-    polyTree.dbg_print(std::cout);
-#endif
+    std::sort(chords.begin(), chords.end(), lessChord);
+
+    Outline result;
+
+    for (size_t i = 0; i < joined.numContours(); ++i) {
+        Outline::Contour contour = joined.contour(i);
+        const Point* V = contour.points;
 
-    holes.clear();
+        result.moveTo(V[0]);
 
-    std::list<const Tree*> trees = polyTree.toList();
-    trees.pop_front(); // Skip the root, which is empty
+        for (size_t j = 1; j < contour.numPoints; ++j) {
+            Chord key = { V[j - 1], V[j], nullptr, false };
+            auto found = std::lower_bound(chords.begin(), chords.end(), key, lessChord);
+
+            if (found == chords.end() || lessChord(key, *found)) {
+                result.lineTo(V[j]);
+            }
+            else if (found->reversed) {
+                result.curveTo(found->ctrl[2], found->ctrl[1], found->ctrl[0]);
+            }
+            else {
+                result.curveTo(found->ctrl[1], found->ctrl[2], found->ctrl[3]);
+            }
+        }
 
-    for (const Tree* tree : trees) {
-        polyList.push_back(cgal_approx::PolygonWithHoles(tree->outer, tree->holes.begin(), tree->holes.end()));
+        result.closePath();
     }
 
-    return polyList;
+    return result;
 }
 
-PathList toLinearPaths(const PathList& paths) {
-    PathList linear;
+// Joins the contours with the exact polygon kernel alone, whatever the
+// approx engine's settings, each cubic standing in as its chord. They are
+// assembled as for the Bezier engine, each hole belonging to the outer
+// boundary before it, so both accept and reject the same input. Returns
+// false, leaving joined untouched, if any cubic can't be swapped for its
+// chord, as decided by allChordable.
+static bool joinLinearContours(const UnionInput& input, const ArenaVector<size_t> (&indices)[2],
+    Outline& joined) {
+
+    Outline simplified[2];
+
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i : indices[k]) {
+            simplified[k].append(input.contours[i]);
+        }
+
+        if (SIMPLIFY_INPUT_TOLERANCE > 0.0) {
+            simplified[k] = simplifyInput(simplified[k]);
+        }
+    }
 
-    for (const Path& path : paths) {
-        linear.push_back(toLinearPath(path));
+    ArenaVector<Outline::Contour> contours;
+
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i = 0; i < simplified[k].numContours(); ++i) {
+            contours.push_back(simplified[k].contour(i));
+        }
     }
 
-    return linear;
-}
+    if (!allChordable(contours)) {
+        return false;
+    }
 
-PathList toPathList(const cgal_approx::PolyList& polyList) {
-    PathList paths;
+    approx::cgal_approx::PolyList polyLists[2];
+    ArenaVector<Chord> chords;
 
-    for (auto i = polyList.begin(); i != polyList.end(); ++i) {
-        const cgal_approx::PolygonWithHoles& poly = *i;
-        const cgal_approx::Polygon& outer = poly.outer_boundary();
+    for (int k = 0; k < 2; ++k) {
+        ArenaVector<approx::cgal_approx::Polygon> polygons;
+        ArenaVector<ContourArea> areas;
+        Outline linear;
 
-        paths.push_back(toPath(outer));
+        for (size_t i = 0; i < simplified[k].numContours(); ++i) {
+            linear.clear();
+            appendChords(linear, simplified[k].contour(i), chords);
 
-        for (auto j = poly.holes_begin(); j != poly.holes_end(); ++j) {
-            paths.push_back(toPath(*j));
+            polygons.push_back(approx::toPolygon(linear.contour(0)));
+            areas.push_back(contourArea(linear.contour(0)));
         }
+
+        polyLists[k] = assemblePolyList<approx::cgal_approx::Polygon, approx::cgal_approx::PolygonWithHoles>(
+            polygons.begin(), polygons.end(), areas.data());
     }
 
-    return paths;
+    joined = restoreChords(approx::exactJoin(polyLists[0], polyLists[1]), chords);
+    return true;
 }
+#endif
 
-PathList computeUnion(const PathList& paths1, const PathList& paths2) {
-    PathList linear1 = toLinearPaths(paths1);
-    PathList linear2 = toLinearPaths(paths2);
+#ifdef APPROX_BEZIERS
+// Joins the contours with the native clipper, straight from their flattened
+// outlines. Prepared contours are read back from their polygons, which were
+// flattened when they were prepared. Returns false, leaving joined
+// untouched, if the clipper failed.
+static bool joinNative(const UnionInput& input, const ArenaVector<size_t> (&indices)[2], Outline& joined) {
+    Outline linear[2];
+
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i : indices[k]) {
+            const PreparedOperand::Polygon* prepared = input.preparedPolygon(i);
+
+            if (prepared != nullptr) {
+                approx::appendContour(linear[k], *prepared);
+            }
+            else {
+                linear[k].append(approx::flattenContour(input.contours[i]));
+            }
+        }
+    }
+
+    return approx::nativeUnion(linear[0], linear[1], joined);
+}
+#endif
 
-    cgal_approx::PolyList polyList1 = approx::toPolyList(linear1);
-    cgal_approx::PolyList polyList2 = approx::toPolyList(linear2);
+// Joins the given contours of each operand as polygons of the engine
+static Outline joinPolygons(const UnionInput& input, const ArenaVector<size_t> (&indices)[2]) {
+    typedef std::reference_wrapper<const PreparedOperand::Polygon> PolygonRef;
 
-    cgal_approx::PolygonSet polySet;
+    EngineConverter convert;
+    ArenaList<PreparedOperand::Polygon> converted;
+    ArenaVector<PolygonRef> polygons[2];
+    ArenaVector<ContourArea> areas[2];
+
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i : indices[k]) {
+            const PreparedOperand::Polygon* prepared = input.preparedPolygon(i);
+
+            if (prepared == nullptr) {
+                converted.push_back(convert(input.contours[i]));
+                prepared = &converted.back();
+            }
 
-    for (auto i : polyList1) {
-        polySet.join(i);
+            polygons[k].push_back(std::cref(*prepared));
+            areas[k].push_back(contourArea(input.contours[i]));
+        }
     }
 
-    for (auto i : polyList2) {
-        polySet.join(i);
+    return joinPolyLists(toEnginePolyList(polygons[0].begin(), polygons[0].end(), areas[0].data()),
+        toEnginePolyList(polygons[1].begin(), polygons[1].end(), areas[1].data()));
+}
+
+// Runs the boolean engine on the given contours of each operand
+static Outline joinContours(const UnionInput& input, const ArenaVector<size_t> (&indices)[2]) {
+#ifndef APPROX_BEZIERS
+    Outline joined;
+
+    if (USE_LINEAR_ENGINE && joinLinearContours(input, indices, joined)) {
+        if (SIMPLIFY_OUTPUT_TOLERANCE > 0.0) {
+            joined = simplifyOutput(joined);
+        }
+
+        return joined;
     }
+#else
+    Outline joined;
+#endif
 
-    cgal_approx::PolyList polyList;
-    polySet.polygons_with_holes(std::back_inserter(polyList));
+#ifdef APPROX_BEZIERS
+    if (!approx::USE_NATIVE_CLIPPER || !joinNative(input, indices, joined)) {
+        joined = joinPolygons(input, indices);
+    }
+#else
+    joined = joinPolygons(input, indices);
+#endif
 
-    return toPathList(polyList);
-}
+#ifdef APPROX_BEZIERS
+    if (approx::RESTORE_CURVES) {
+        Outline source;
 
+        for (int k = 0; k < 2; ++k) {
+            for (size_t i : indices[k]) {
+                source.append(input.contours[i]);
+            }
+        }
 
-}
+        joined = approx::restoreCurves(joined, source);
+    }
 #endif
 
+    if (SIMPLIFY_OUTPUT_TOLERANCE > 0.0) {
+        joined = simplifyOutput(joined);
+    }
 
-PathList computeUnion(const PathList& paths1, const PathList& paths2) {
 #ifdef APPROX_BEZIERS
-    return approx::computeUnion(paths1, paths2);
+    if (approx::CURVE_FIT_TOLERANCE > 0.0) {
+        joined = approx::fitCurves(joined, approx::CURVE_FIT_TOLERANCE);
+    }
 #endif
 
-    cgal_wrap::PolyList polyList1 = toPolyList(paths1);
-    cgal_wrap::PolyList polyList2 = toPolyList(paths2);
+    return joined;
+}
+
+// Whether contours of one outline may overlap one another, in which case
+// only the engine can merge them. Contours whose boxes are apart can't, and
+// nor can nested ones whose orientations alternate with their depth, as a
+// well-formed glyph's outer boundaries and counters do. Any other pair of
+// overlapping boxes, one not inside the other, may.
+static bool mayOverlap(const UnionInput& input, const ArenaVector<size_t>& contours) {
+    const ArenaVector<BoundingBox>& boxes = input.boxes;
+
+    ArenaVector<size_t> order(contours);
+    ArenaVector<size_t> depth(input.size(), 0);
+
+    std::sort(order.begin(), order.end(), [&boxes](size_t a, size_t b) {
+        return boxes[a].xmin < boxes[b].xmin;
+    });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const BoundingBox& a = boxes[order[i]];
+
+        for (size_t j = i + 1; j < order.size(); ++j) {
+            const BoundingBox& b = boxes[order[j]];
+
+            if (b.xmin > a.xmax + FLOAT_PRECISION) {
+                break;
+            }
+
+            if (!a.overlaps(b)) {
+                continue;
+            }
+
+            bool aInB = b.contains(a);
+            bool bInA = a.contains(b);
+
+            if (aInB == bInA) {
+                return true;
+            }
+
+            ++depth[aInB ? order[i] : order[j]];
+        }
+    }
+
+    for (size_t i : contours) {
+        CGAL::Orientation expected = depth[i] % 2 == 0 ? CGAL::COUNTERCLOCKWISE : CGAL::CLOCKWISE;
+
+        if (contourArea(input.contours[i]).orientation != expected) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
-    cgal_wrap::BezierPolygonSet polySet;
+// Contours whose bounding boxes cannot touch anything from the other outline
+// are copied straight to the output, unless they may overlap one another.
+// Where they can, contours lying wholly inside the other outline's filled
+// region are dropped. Only what is left goes to the boolean engine, which
+// merges any overlaps within an outline as well as between the two.
+static Outline unionOf(UnionInput& input) {
+    size_t n = input.size();
 
-    for (auto i : polyList1) {
-        polySet.join(i);
+    BoundingBox box1, box2;
+    ArenaVector<size_t> contours[2];
+
+    for (size_t i = 0; i < n; ++i) {
+        (input.operand(i) == 0 ? box1 : box2).extend(input.boxes[i]);
+
+        if (!input.contours[i].empty()) {
+            contours[input.operand(i)].push_back(i);
+        }
     }
 
-    for (auto i : polyList2) {
-        polySet.join(i);
+    Outline result;
+
+    if (!box1.overlaps(box2) && !mayOverlap(input, contours[0]) && !mayOverlap(input, contours[1])) {
+        for (int k = 0; k < 2; ++k) {
+            for (size_t i : contours[k]) {
+                result.append(input.contours[i]);
+            }
+        }
+
+        return result;
     }
 
-    cgal_wrap::PolyList polyList;
-    polySet.polygons_with_holes(std::back_inserter(polyList));
+    ArenaVector<size_t> root = groupContours(input);
+
+    ArenaVector<size_t> order;
+
+    for (int k = 0; k < 2; ++k) {
+        order.insert(order.end(), contours[k].begin(), contours[k].end());
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&root](size_t a, size_t b) {
+        return root[a] < root[b];
+    });
+
+    ArenaVector<uint8_t> dropped(n, 0);
+    ArenaVector<uint8_t> needsEngine(n, 0);
+    ArenaVector<size_t> group;
+    ArenaVector<size_t> kept[2];
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        group.push_back(order[i]);
+
+        if (i + 1 < order.size() && root[order[i + 1]] == root[order[i]]) {
+            continue;
+        }
+
+        // Only a group with contours from both outlines can have some made
+        // redundant by the other outline
+        int sources = 0;
+
+        for (size_t j : group) {
+            sources |= 1 << input.operand(j);
+        }
+
+        if (sources == 3) {
+            dropDominated(input, group, dropped);
+        }
+
+        kept[0].clear();
+        kept[1].clear();
+
+        for (size_t j : group) {
+            if (!dropped[j]) {
+                kept[input.operand(j)].push_back(j);
+            }
+        }
+
+        needsEngine[root[order[i]]] = (!kept[0].empty() && !kept[1].empty())
+            || mayOverlap(input, kept[0]) || mayOverlap(input, kept[1]);
+
+        group.clear();
+    }
+
+    ArenaVector<size_t> joined[2];
+
+    for (int k = 0; k < 2; ++k) {
+        for (size_t i : contours[k]) {
+            if (dropped[i]) {
+                continue;
+            }
+
+            if (needsEngine[root[i]]) {
+                joined[k].push_back(i);
+            }
+            else {
+                result.append(input.contours[i]);
+            }
+        }
+    }
+
+    if (!joined[0].empty() || !joined[1].empty()) {
+        result.append(joinContours(input, joined));
+    }
 
-    return toPathList(polyList);
+    return result;
+}
+
+Outline computeUnion(const Outline& outline1, const Outline& outline2) {
+    UnionInput input(outline1, outline2, nullptr);
+    return unionOf(input);
+}
+
+Outline computeUnion(const Outline& outline, const PreparedOperand& prepared) {
+    UnionInput input(outline, prepared.outline(), &prepared);
+    return unionOf(input);
+}
+
+// Balanced, so every outline takes part in O(log n) unions, and neighbours
+// in the list, which tend to be near each other, meet first
+static Outline unionOfRange(const Outline* begin, const Outline* end) {
+    if (end - begin == 1) {
+        return *begin;
+    }
+
+    const Outline* mid = begin + (end - begin) / 2;
+
+    return computeUnion(unionOfRange(begin, mid), unionOfRange(mid, end));
+}
+
+Outline computeUnion(const std::vector<Outline>& outlines) {
+    if (outlines.empty()) {
+        return Outline();
+    }
+
+    return unionOfRange(outlines.data(), outlines.data() + outlines.size());
+}
+
+PathList computeUnion(const PathList& paths1, const PathList& paths2) {
+    return toPathList(computeUnion(toOutline(paths1), toOutline(paths2)));
 }
 
 
@@ -0,0 +1,237 @@
+#include <cassert>
+#include "Geometry.hpp"
+
+
+namespace csmerge {
+namespace geometry {
+
+
+bool Outline::Contour::empty() const {
+    return numVerbs == 0;
+}
+
+bool Outline::Contour::isClosed() const {
+    return finalPoint() == initialPoint();
+}
+
+const Point& Outline::Contour::initialPoint() const {
+    return points[0];
+}
+
+const Point& Outline::Contour::finalPoint() const {
+    return points[numPoints - 1];
+}
+
+BoundingBox Outline::Contour::bbox() const {
+    BoundingBox box;
+
+    for (size_t i = 0; i < numPoints; ++i) {
+        box.extend(points[i]);
+    }
+
+    return box;
+}
+
+
+void Outline::beginContour(const Point& P) {
+    m_contourVerbs.push_back(m_verbs.size());
+    m_contourPoints.push_back(m_points.size());
+    m_points.push_back(P);
+}
+
+void Outline::moveTo(const Point& P) {
+    if (!m_contourVerbs.empty() && m_contourVerbs.back() == m_verbs.size()) {
+        m_points.back() = P;
+    }
+    else {
+        beginContour(P);
+    }
+}
+
+void Outline::lineTo(const Point& B) {
+    if (m_contourVerbs.empty()) {
+        beginContour(Point(0, 0));
+    }
+
+    m_verbs.push_back(LINE);
+    m_points.push_back(B);
+}
+
+void Outline::curveTo(const Point& B, const Point& C, const Point& D) {
+    if (m_contourVerbs.empty()) {
+        beginContour(Point(0, 0));
+    }
+
+    m_verbs.push_back(CUBIC);
+    m_points.push_back(B);
+    m_points.push_back(C);
+    m_points.push_back(D);
+}
+
+void Outline::closePath() {
+    if (m_contourVerbs.empty() || m_contourVerbs.back() == m_verbs.size()) {
+        return;
+    }
+
+    const Point& initial = m_points[m_contourPoints.back()];
+
+    if (m_points.back() != initial) {
+        lineTo(Point(initial));
+    }
+}
+
+void Outline::append(const Outline& outline) {
+    size_t verbOffset = m_verbs.size();
+    size_t pointOffset = m_points.size();
+
+    m_verbs.insert(m_verbs.end(), outline.m_verbs.begin(), outline.m_verbs.end());
+    m_points.insert(m_points.end(), outline.m_points.begin(), outline.m_points.end());
+
+    for (size_t i = 0; i < outline.m_contourVerbs.size(); ++i) {
+        m_contourVerbs.push_back(outline.m_contourVerbs[i] + verbOffset);
+        m_contourPoints.push_back(outline.m_contourPoints[i] + pointOffset);
+    }
+}
+
+void Outline::append(const Contour& contour) {
+    m_contourVerbs.push_back(m_verbs.size());
+    m_contourPoints.push_back(m_points.size());
+
+    m_verbs.insert(m_verbs.end(), contour.verbs, contour.verbs + contour.numVerbs);
+    m_points.insert(m_points.end(), contour.points, contour.points + contour.numPoints);
+}
+
+void Outline::reserve(size_t numVerbs, size_t numPoints) {
+    m_verbs.reserve(numVerbs);
+    m_points.reserve(numPoints);
+}
+
+void Outline::clear() {
+    m_verbs.clear();
+    m_points.clear();
+    m_contourVerbs.clear();
+    m_contourPoints.clear();
+}
+
+bool Outline::empty() const {
+    return m_verbs.empty();
+}
+
+size_t Outline::numContours() const {
+    return m_contourVerbs.size();
+}
+
+Outline::Contour Outline::contour(size_t idx) const {
+    assert(idx < m_contourVerbs.size());
+
+    size_t firstVerb = m_contourVerbs[idx];
+    size_t firstPoint = m_contourPoints[idx];
+    size_t endVerb = idx + 1 < m_contourVerbs.size() ? m_contourVerbs[idx + 1] : m_verbs.size();
+    size_t endPoint = idx + 1 < m_contourPoints.size() ? m_contourPoints[idx + 1] : m_points.size();
+
+    Contour c;
+    c.verbs = m_verbs.data() + firstVerb;
+    c.numVerbs = endVerb - firstVerb;
+    c.points = m_points.data() + firstPoint;
+    c.numPoints = endPoint - firstPoint;
+
+    return c;
+}
+
+const std::vector<Outline::Verb>& Outline::verbs() const {
+    return m_verbs;
+}
+
+const std::vector<Point>& Outline::points() const {
+    return m_points;
+}
+
+
+// Visitor appending each curve of a Path to an Outline
+class OutlineAppender {
+    public:
+        explicit OutlineAppender(Outline& outline)
+            : m_outline(outline) {}
+
+        void operator()(const LineSegment& lseg) const {
+            m_outline.lineTo(lseg.B());
+        }
+
+        void operator()(const CubicBezier& bezier) const {
+            m_outline.curveTo(bezier.B(), bezier.C(), bezier.D());
+        }
+
+    private:
+        Outline& m_outline;
+};
+
+
+Outline toOutline(const PathList& paths) {
+    Outline outline;
+    OutlineAppender appender(outline);
+
+    for (const Path& path : paths) {
+        outline.moveTo(path.initialPoint());
+
+        for (auto i = path.begin(); i != path.end(); ++i) {
+            visitCurve(**i, appender);
+        }
+    }
+
+    return outline;
+}
+
+PathList toPathList(const Outline& outline) {
+    PathList paths;
+    paths.reserve(outline.numContours());
+
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        Outline::Contour contour = outline.contour(i);
+
+        paths.push_back(Path());
+        Path& path = paths.back();
+
+        const Point* A = contour.points;
+
+        for (size_t j = 0; j < contour.numVerbs; ++j) {
+            if (contour.verbs[j] == Outline::LINE) {
+                path.append(LineSegment(A[0], A[1]));
+                A += 1;
+            }
+            else {
+                path.append(CubicBezier(A[0], A[1], A[2], A[3]));
+                A += 3;
+            }
+        }
+    }
+
+    return paths;
+}
+
+
+std::ostream& operator<<(std::ostream& out, const Outline& outline) {
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        Outline::Contour contour = outline.contour(i);
+        const Point* A = contour.points;
+
+        out << "Contour " << i << " from " << A[0] << std::endl;
+
+        for (size_t j = 0; j < contour.numVerbs; ++j) {
+            if (contour.verbs[j] == Outline::LINE) {
+                out << "LineSegment[" << A[0] << ", " << A[1] << "]" << std::endl;
+                A += 1;
+            }
+            else {
+                out << "CubicBezier[" << A[0] << ", " << A[1] << ", " << A[2] << ", " << A[3] << "]"
+                    << std::endl;
+                A += 3;
+            }
+        }
+    }
+
+    return out;
+}
+
+
+}
+}
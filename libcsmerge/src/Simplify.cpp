@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cmath>
+#include "Arena.hpp"
+#include "Geometry.hpp"
+
+
+// Clean-up of outlines before and after the boolean engine: normalisation,
+// which removes degenerate segments, and Douglas-Peucker simplification of
+// the line segments. Simplification leaves curves alone, and keeps their
+// ends, so only runs of lines between them are simplified.
+
+
+namespace csmerge {
+namespace geometry {
+
+
+double SIMPLIFY_INPUT_TOLERANCE = 0; // Disabled by default
+double SIMPLIFY_OUTPUT_TOLERANCE = 0; // Disabled by default
+
+
+static double distanceToSegment(const Point& P, const Point& A, const Point& B) {
+    Point AB = B - A;
+    Point AP = P - A;
+
+    double lenSq = AB.x * AB.x + AB.y * AB.y;
+    double t = lenSq > 0.0 ? (AP.x * AB.x + AP.y * AB.y) / lenSq : 0.0;
+    t = std::max(0.0, std::min(1.0, t));
+
+    double dx = AP.x - t * AB.x;
+    double dy = AP.y - t * AB.y;
+
+    return sqrt(dx * dx + dy * dy);
+}
+
+// Marks the vertices strictly between first and last that must be kept for
+// the polyline to stay within the tolerance of them all
+static void markKept(const ArenaVector<Point>& V, size_t first, size_t last, double tolerance,
+    ArenaVector<uint8_t>& keep) {
+
+    ArenaVector<std::pair<size_t, size_t>> spans;
+    spans.push_back(std::make_pair(first, last));
+
+    while (!spans.empty()) {
+        size_t a = spans.back().first;
+        size_t b = spans.back().second;
+        spans.pop_back();
+
+        double worst = tolerance;
+        size_t split = a;
+
+        for (size_t i = a + 1; i < b; ++i) {
+            double dist = distanceToSegment(V[i], V[a], V[b]);
+
+            if (dist > worst) {
+                worst = dist;
+                split = i;
+            }
+        }
+
+        if (split != a) {
+            keep[split] = 1;
+            spans.push_back(std::make_pair(a, split));
+            spans.push_back(std::make_pair(split, b));
+        }
+    }
+}
+
+static size_t simplifyContour(const Outline::Contour& contour, double tolerance, Outline& outline) {
+    // Vertices along the contour, and whether each edge to the next vertex
+    // is a cubic, whose inner control points are kept aside
+    ArenaVector<Point> V;
+    ArenaVector<const Point*> cubic;
+
+    const Point* A = contour.points;
+    V.push_back(A[0]);
+
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        if (contour.verbs[i] == Outline::CUBIC) {
+            cubic.push_back(A);
+            V.push_back(A[3]);
+            A += 3;
+        }
+        else {
+            cubic.push_back(nullptr);
+            V.push_back(A[1]);
+            A += 1;
+        }
+    }
+
+    size_t m = cubic.size();
+    bool closed = m > 0 && V[m].x == V[0].x && V[m].y == V[0].y;
+
+    if (m < 2) {
+        outline.append(contour);
+        return 0;
+    }
+
+    size_t firstCubic = std::find_if(cubic.begin(), cubic.end(), [](const Point* c) { return c != nullptr; })
+        - cubic.begin();
+
+    bool anyCubic = firstCubic < m;
+
+    // A closed contour is started at the start of a curve, if it has one
+    if (closed && anyCubic) {
+        std::rotate(cubic.begin(), cubic.begin() + firstCubic, cubic.end());
+
+        V.pop_back();
+        std::rotate(V.begin(), V.begin() + firstCubic, V.end());
+        V.push_back(V[0]);
+    }
+
+    // The ends of curves, and of the contour, are kept
+    ArenaVector<uint8_t> keep(m + 1, 0);
+    keep[0] = keep[m] = 1;
+
+    for (size_t i = 0; i < m; ++i) {
+        if (cubic[i] != nullptr) {
+            keep[i] = keep[i + 1] = 1;
+        }
+    }
+
+    // A closed contour of lines is also anchored at the vertex furthest from
+    // its start, so it can't shrink to a line from the start back to itself
+    if (closed && !anyCubic) {
+        size_t furthest = 0;
+        double best = -1.0;
+
+        for (size_t i = 1; i < m; ++i) {
+            Point d = V[i] - V[0];
+            double distSq = d.x * d.x + d.y * d.y;
+
+            if (distSq > best) {
+                best = distSq;
+                furthest = i;
+            }
+        }
+
+        keep[furthest] = 1;
+    }
+
+    for (size_t a = 0; a < m;) {
+        size_t b = a + 1;
+
+        while (!keep[b]) {
+            ++b;
+        }
+
+        markKept(V, a, b, tolerance, keep);
+        a = b;
+    }
+
+    size_t kept = std::count(keep.begin(), keep.end(), 1);
+
+    // Don't let a closed contour of lines collapse to nothing
+    if (closed && !anyCubic && kept < 4) {
+        outline.append(contour);
+        return 0;
+    }
+
+    outline.moveTo(V[0]);
+
+    for (size_t i = 0; i < m; ++i) {
+        if (cubic[i] != nullptr) {
+            outline.curveTo(cubic[i][1], cubic[i][2], V[i + 1]);
+        }
+        else if (keep[i + 1]) {
+            outline.lineTo(V[i + 1]);
+        }
+    }
+
+    return m + 1 - kept;
+}
+
+// Normalisation uses fixed tolerances rather than FLOAT_PRECISION, which may
+// be raised far enough to merge real points. Charstring coordinates lie on a
+// 16.16 grid, so points closer than half a step of it are the same point.
+static const double SAME_POINT_TOLERANCE = 0.5 / 65536;
+
+// A cubic whose inner control points are this close to its chord strays no
+// further than three quarters of it from the chord
+static const double STRAIGHT_TOLERANCE = 1.0 / 1024;
+
+static bool samePoint(const Point& A, const Point& B) {
+    return fabs(A.x - B.x) < SAME_POINT_TOLERANCE && fabs(A.y - B.y) < SAME_POINT_TOLERANCE;
+}
+
+// Whether the cubic's inner control points lie on its chord, in which case
+// it traces nothing but the chord
+static bool isStraight(const Point& A, const Point& B, const Point& C, const Point& D) {
+    return distanceToSegment(B, A, D) <= STRAIGHT_TOLERANCE && distanceToSegment(C, A, D) <= STRAIGHT_TOLERANCE;
+}
+
+static void normaliseContour(const Outline::Contour& contour, Outline& outline) {
+    const Point& start = contour.initialPoint();
+    Point cursor = start;
+
+    outline.moveTo(start);
+
+    const Point* A = contour.points;
+
+    for (size_t i = 0; i < contour.numVerbs; ++i) {
+        bool cubic = contour.verbs[i] == Outline::CUBIC;
+
+        // Returning to the start, it's the start exactly
+        Point D = cubic ? A[3] : A[1];
+
+        if (samePoint(D, start)) {
+            D = start;
+        }
+
+        if (!cubic || isStraight(cursor, A[1], A[2], D)) {
+            if (!samePoint(D, cursor)) {
+                outline.lineTo(D);
+                cursor = D;
+            }
+        }
+        else {
+            outline.curveTo(A[1], A[2], D);
+            cursor = D;
+        }
+
+        A += cubic ? 3 : 1;
+    }
+}
+
+Outline normalise(const Outline& outline) {
+    Outline result;
+    result.reserve(outline.verbs().size(), outline.points().size());
+
+    Outline part;
+
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        part.clear();
+        normaliseContour(outline.contour(i), part);
+
+        if (!part.empty()) {
+            result.append(part);
+        }
+    }
+
+    return result;
+}
+
+Outline simplify(const Outline& outline, double tolerance, size_t& removed) {
+    Outline result;
+    result.reserve(outline.verbs().size(), outline.points().size());
+
+    removed = 0;
+
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        removed += simplifyContour(outline.contour(i), tolerance, result);
+    }
+
+    return result;
+}
+
+PathList simplify(const PathList& paths, double tolerance, size_t& removed) {
+    return toPathList(simplify(toOutline(paths), tolerance, removed));
+}
+
+SimplifyStats& simplifyStats() {
+    static thread_local SimplifyStats stats;
+    return stats;
+}
+
+Outline simplifyInput(const Outline& outline) {
+    size_t removed;
+    Outline result = simplify(outline, SIMPLIFY_INPUT_TOLERANCE, removed);
+
+    simplifyStats().inputVerticesRemoved += removed;
+    return result;
+}
+
+Outline simplifyOutput(const Outline& outline) {
+    size_t removed;
+    Outline result = simplify(outline, SIMPLIFY_OUTPUT_TOLERANCE, removed);
+
+    simplifyStats().outputVerticesRemoved += removed;
+    return result;
+}
+
+
+}
+}
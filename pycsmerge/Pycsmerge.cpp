@@ -44,12 +44,11 @@ struct CsTokenFromPythonString {
 
         typedef py::converter::rvalue_from_python_storage<CsToken> rval_t;
 
-        long int size;
-        const char* value = PyUnicode_AsUTF8AndSize(objPtr, &size);
+        const char* value = PyUnicode_AsUTF8(objPtr);
         assert(value);
 
         void* storage = reinterpret_cast<rval_t*>(data)->storage.bytes;
-        new (storage) CsToken(std::string(value, size));
+        new (storage) CsToken(value);
 
         data->convertible = storage;
     }
@@ -74,7 +73,7 @@ static py::list mergeCharstrings_helper(py::list& cs1Tokens, py::list& cs2Tokens
     for (const CsToken& tok : merged) {
         switch (tok.type) {
             case PS_OPERATOR:
-                result.append(tok.str);
+                result.append(tok.str());
                 break;
             case PS_OPERAND:
                 result.append(tok.num);
@@ -85,6 +84,49 @@ static py::list mergeCharstrings_helper(py::list& cs1Tokens, py::list& cs2Tokens
     return result;
 }
 
+static Type2Charstring bytesToType2(const py::object& obj) {
+    char* data;
+    Py_ssize_t size;
+
+    if (PyBytes_AsStringAndSize(obj.ptr(), &data, &size) == -1) {
+        py::throw_error_already_set();
+    }
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    return Type2Charstring(bytes, bytes + size);
+}
+
+static py::object mergeType2Charstrings_helper(const py::object& cs1Bytes, const py::object& cs2Bytes) {
+    Type2Charstring cs1 = bytesToType2(cs1Bytes);
+    Type2Charstring cs2 = bytesToType2(cs2Bytes);
+
+    Type2Charstring merged;
+    mergeCharstrings(cs1, cs2, merged);
+
+    PyObject* result = PyBytes_FromStringAndSize(reinterpret_cast<const char*>(merged.data()),
+        merged.size());
+
+    return py::object(py::handle<>(result));
+}
+
+static geometry::PreparedOperand* prepareType2Charstring_helper(const py::object& csBytes) {
+    return new geometry::PreparedOperand(prepareCharstring(bytesToType2(csBytes)));
+}
+
+static py::object mergeType2Prepared_helper(const py::object& csBytes,
+    const geometry::PreparedOperand& prepared) {
+
+    Type2Charstring cs = bytesToType2(csBytes);
+
+    Type2Charstring merged;
+    mergeCharstrings(cs, prepared, merged);
+
+    PyObject* result = PyBytes_FromStringAndSize(reinterpret_cast<const char*>(merged.data()),
+        merged.size());
+
+    return py::object(py::handle<>(result));
+}
+
 static void translateException(const CsMergeException& ex) {
     PyErr_SetString(PyExc_RuntimeWarning, ex.what());
 }
@@ -113,15 +155,132 @@ static int getMaxLsegsPerBezier() {
     return geometry::MAX_LSEGS_PER_BEZIER;
 }
 
+static void setFlatteningTolerance(double tolerance) {
+    geometry::FLATTENING_TOLERANCE = tolerance;
+}
+
+static double getFlatteningTolerance() {
+    return geometry::FLATTENING_TOLERANCE;
+}
+
+static void setSimplifyInputTolerance(double tolerance) {
+    geometry::SIMPLIFY_INPUT_TOLERANCE = tolerance;
+}
+
+static double getSimplifyInputTolerance() {
+    return geometry::SIMPLIFY_INPUT_TOLERANCE;
+}
+
+static void setSimplifyOutputTolerance(double tolerance) {
+    geometry::SIMPLIFY_OUTPUT_TOLERANCE = tolerance;
+}
+
+static double getSimplifyOutputTolerance() {
+    return geometry::SIMPLIFY_OUTPUT_TOLERANCE;
+}
+
+// Vertices removed by simplification on this thread, as (input, output)
+static py::tuple getSimplifyStats() {
+    const geometry::SimplifyStats& stats = geometry::simplifyStats();
+    return py::make_tuple(stats.inputVerticesRemoved, stats.outputVerticesRemoved);
+}
+
+static void resetSimplifyStats() {
+    geometry::simplifyStats() = geometry::SimplifyStats();
+}
+
+static void setNormaliseOutlines(bool normaliseOutlines) {
+    NORMALISE_OUTLINES = normaliseOutlines;
+}
+
+static bool getNormaliseOutlines() {
+    return NORMALISE_OUTLINES;
+}
+
+#ifdef APPROX_BEZIERS
+static void setUseFastKernel(bool useFastKernel) {
+    geometry::approx::USE_FAST_KERNEL = useFastKernel;
+}
+
+static bool getUseFastKernel() {
+    return geometry::approx::USE_FAST_KERNEL;
+}
+
+static void setUseNativeClipper(bool useNativeClipper) {
+    geometry::approx::USE_NATIVE_CLIPPER = useNativeClipper;
+}
+
+static bool getUseNativeClipper() {
+    return geometry::approx::USE_NATIVE_CLIPPER;
+}
+
+static void setRestoreCurves(bool restoreCurves) {
+    geometry::approx::RESTORE_CURVES = restoreCurves;
+}
+
+static bool getRestoreCurves() {
+    return geometry::approx::RESTORE_CURVES;
+}
+
+static void setCurveFitTolerance(double tolerance) {
+    geometry::approx::CURVE_FIT_TOLERANCE = tolerance;
+}
+
+static double getCurveFitTolerance() {
+    return geometry::approx::CURVE_FIT_TOLERANCE;
+}
+#endif
+
+#ifndef APPROX_BEZIERS
+static void setUseLinearEngine(bool useLinearEngine) {
+    geometry::USE_LINEAR_ENGINE = useLinearEngine;
+}
+
+static bool getUseLinearEngine() {
+    return geometry::USE_LINEAR_ENGINE;
+}
+#endif
+
 BOOST_PYTHON_MODULE(_pycsmerge) {
     py::def("initialise", &csmerge::initialise);
     py::def("merge_charstrings", &mergeCharstrings_helper);
+    py::def("merge_type2_charstrings", &mergeType2Charstrings_helper);
+    py::def("merge_type2_charstrings", &mergeType2Prepared_helper);
+    py::def("prepare_type2_charstring", &prepareType2Charstring_helper,
+        py::return_value_policy<py::manage_new_object>());
     py::def("set_float_precision", &setFloatPrecision);
     py::def("get_float_precision", &getFloatPrecision);
     py::def("set_min_lseg_length", &setMinLsegLength);
     py::def("get_min_lseg_length", &getMinLsegLength);
     py::def("set_max_lsegs_per_bezier", &setMaxLsegsPerBezier);
     py::def("get_max_lsegs_per_bezier", &getMaxLsegsPerBezier);
+    py::def("set_flattening_tolerance", &setFlatteningTolerance);
+    py::def("get_flattening_tolerance", &getFlatteningTolerance);
+    py::def("set_relative_flattening_tolerance", &geometry::setRelativeFlatteningTolerance);
+    py::def("set_simplify_input_tolerance", &setSimplifyInputTolerance);
+    py::def("get_simplify_input_tolerance", &getSimplifyInputTolerance);
+    py::def("set_simplify_output_tolerance", &setSimplifyOutputTolerance);
+    py::def("get_simplify_output_tolerance", &getSimplifyOutputTolerance);
+    py::def("get_simplify_stats", &getSimplifyStats);
+    py::def("reset_simplify_stats", &resetSimplifyStats);
+    py::def("set_normalise_outlines", &setNormaliseOutlines);
+    py::def("get_normalise_outlines", &getNormaliseOutlines);
+#ifdef APPROX_BEZIERS
+    py::def("set_use_fast_kernel", &setUseFastKernel);
+    py::def("get_use_fast_kernel", &getUseFastKernel);
+    py::def("set_use_native_clipper", &setUseNativeClipper);
+    py::def("get_use_native_clipper", &getUseNativeClipper);
+    py::def("set_restore_curves", &setRestoreCurves);
+    py::def("get_restore_curves", &getRestoreCurves);
+    py::def("set_curve_fit_tolerance", &setCurveFitTolerance);
+    py::def("get_curve_fit_tolerance", &getCurveFitTolerance);
+#endif
+#ifndef APPROX_BEZIERS
+    py::def("set_use_linear_engine", &setUseLinearEngine);
+    py::def("get_use_linear_engine", &getUseLinearEngine);
+#endif
+
+    py::class_<geometry::PreparedOperand, boost::noncopyable>("PreparedOperand", py::no_init);
 
     py::class_<CsToken>("CsToken", py::init<double>())
         .def(py::init<const std::string&>())
@@ -0,0 +1,42 @@
+import sys
+import timeit
+from pycsmerge import *
+
+
+# Times merges with the exact (EPECK) and fast (EPICK) kernels. Only the
+# APPROX_BEZIERS build has the fast kernel.
+
+ROUNDS = 200
+
+watermark = [
+    0, -237, 'rmoveto', 28.3625, 0, 'rlineto', 274.1375, 425.96466584292557, 'rlineto', 274.13750000000005, -425.96466584292557, 'rlineto', 28.362499999999955, 0, 'rlineto', -288.31875, 448.0, 'rlineto', 288.31875, 448.0, 'rlineto', -28.362499999999955, 0, 'rlineto', -274.13750000000005, -425.96466584292557, 'rlineto', -274.1375, 425.96466584292557, 'rlineto', -28.3625, 0, 'rlineto', 288.31875, -448.0, 'rlineto', -288.31875, -448.0, 'rlineto', 0, 237, 'rmoveto'
+]
+
+glyphs = {
+    'lines': [
+        472, 368, 'rmoveto', -133, 225, 258, 66, -589, -66, 257, -225, -133, -66, 133, -302, 74, 302, 133, 'hlineto', 'endchar'
+    ],
+    'curves': [
+        215, 450, 'rmoveto', 3, -27, 0, -81, -96, 'vvcurveto', -95, -1, -98, -2, -25, 'vhcurveto', -90, -3, 'rlineto', -25, 265, 25, 'vlineto', -92, 3, 'rlineto', -1, 24, -2, 75, 110, 'vvcurveto', 0, 'vlineto', 94, 1, 98, 1, 21, 'vhcurveto', 91, 'hlineto', 16, 19, -29, -86, 32, 'hvcurveto', 12, 'hlineto', -7, 156, 'rlineto', -5, 'hlineto', -28, -11, 'rlineto', -342, 'hlineto', -28, 11, 'rlineto', -5, 'hlineto', -7, -156, 'rlineto', 12, 'hlineto', 86, 32, 19, 29, 16, 'hhcurveto', 132, 143, 'rmoveto', -39, 42, -47, 47, -36, 27, -17, -3, 'rcurveline', 35, -46, 48, -76, 26, -48, 'rrcurveto', -3, 10, 12, -1, 8, 'hhcurveto', 8, 12, 1, 3, 10, 'hvcurveto', 26, 48, 48, 76, 35, 46, -17, 3, 'rcurveline', -36, -27, -47, -47, -39, -42, 'rrcurveto', 'endchar'
+    ]
+}
+
+
+def timeMerges(glyph):
+    return timeit.timeit(lambda: merge_charstrings(glyph, watermark), number=ROUNDS) / ROUNDS
+
+
+if __name__ == '__main__':
+    if 'set_use_fast_kernel' not in globals():
+        sys.exit('pycsmerge was built without APPROX_BEZIERS')
+
+    for name, glyph in sorted(glyphs.items()):
+        set_use_fast_kernel(False)
+        exact = timeMerges(glyph)
+
+        set_use_fast_kernel(True)
+        fast = timeMerges(glyph)
+
+        set_use_fast_kernel(False)
+
+        print('%-8s exact %8.3f ms   fast %8.3f ms   speedup %.2fx' % (name, exact * 1000, fast * 1000, exact / fast))
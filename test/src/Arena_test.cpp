@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <Arena.hpp>
+
+
+using namespace csmerge;
+
+
+class ArenaTest : public testing::Test {
+    public:
+        virtual void SetUp() override {
+
+        }
+
+        virtual void TearDown() override {
+
+        }
+};
+
+
+TEST_F(ArenaTest, alignedAllocations) {
+    Arena arena(256);
+
+    void* a = arena.allocate(3, 1);
+    void* b = arena.allocate(8, 8);
+    void* c = arena.allocate(1000, 16); // Larger than a block
+
+    ASSERT_NE(a, b);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(b) % 8);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(c) % 16);
+    ASSERT_EQ(1011, arena.bytesAllocated());
+
+    arena.release();
+    ASSERT_EQ(0, arena.bytesAllocated());
+}
+
+TEST_F(ArenaTest, oversizedBlocksAreFreed) {
+    Arena arena(256);
+
+    // The first allocation is too big for a standard block
+    arena.allocate(1000, 8);
+    arena.release();
+    ASSERT_EQ(0, arena.bytesReserved());
+
+    char* a = static_cast<char*>(arena.allocate(16, 8));
+    size_t reserved = arena.bytesReserved();
+    ASSERT_EQ(256, reserved);
+
+    // An oversized allocation leaves the current block's tail in use
+    arena.allocate(1000, 8);
+    char* b = static_cast<char*>(arena.allocate(16, 8));
+    ASSERT_EQ(a + 16, b);
+
+    arena.release();
+    ASSERT_EQ(reserved, arena.bytesReserved());
+    ASSERT_EQ(a, arena.allocate(16, 8));
+}
+
+TEST_F(ArenaTest, scopeInstallsArena) {
+    ASSERT_EQ(nullptr, currentArena());
+
+    Arena arena;
+
+    {
+        ArenaScope scope(arena);
+        ASSERT_EQ(&arena, currentArena());
+
+        ArenaList<int> list;
+        for (int i = 0; i < 100; ++i) {
+            list.push_back(i);
+        }
+
+        ASSERT_EQ(&arena, list.get_allocator().arena());
+        ASSERT_LT(0, arena.bytesAllocated());
+
+        {
+            ArenaScope nested;
+            ASSERT_EQ(&arena, currentArena());
+        }
+
+        ASSERT_EQ(&arena, currentArena());
+    }
+
+    ASSERT_EQ(nullptr, currentArena());
+    ASSERT_EQ(0, arena.bytesAllocated());
+}
+
+TEST_F(ArenaTest, disabledScope) {
+    ArenaScope scope(false);
+    ASSERT_EQ(nullptr, currentArena());
+
+    ArenaVector<int> v(10, 1);
+    ASSERT_EQ(nullptr, v.get_allocator().arena());
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <sstream>
 #include <Charstrings.hpp>
+#include <CharstringParser.hpp>
 #include <Geometry.hpp>
 
 
@@ -176,7 +179,435 @@ TEST_F(CharstringTest, watermarkToPoly) {
     PathList paths = parseCharstring(watermark);
     ASSERT_EQ(1, paths.size());
 
-    for (const std::unique_ptr<Curve>& pCurve : paths[0]) {
+    for (const AnyCurve& pCurve : paths[0]) {
         std::cout << (*pCurve) << "\n";
     }
 }
+
+TEST_F(CharstringTest, type2Square) {
+    Type2Charstring cs({
+        129, 129, 21,   // -10 -10 rmoveto
+        159, 7,         // 20 vlineto
+        159, 6,         // 20 hlineto
+        119, 7,         // -20 vlineto
+        119, 6,         // -20 hlineto
+        14              // endchar
+    });
+
+    PathList paths = parseCharstring(cs);
+    ASSERT_EQ(1, paths.size());
+
+    const Path& path = paths.front();
+    ASSERT_EQ(4, path.size());
+
+    ASSERT_EQ(LineSegment(Point(-10, -10), Point(-10, 10)), path[0]);
+    ASSERT_EQ(LineSegment(Point(-10, 10), Point(10, 10)), path[1]);
+    ASSERT_EQ(LineSegment(Point(10, 10), Point(10, -10)), path[2]);
+    ASSERT_EQ(LineSegment(Point(10, -10), Point(-10, -10)), path[3]);
+}
+
+TEST_F(CharstringTest, type2OperandEncodings) {
+    Type2Charstring cs({
+        248, 136,                   // 500
+        252, 136,                   // -500
+        21,                         // rmoveto
+        28, 0x07, 0xd0,             // 2000
+        255, 0x00, 0x01, 0x80, 0x00,  // 1.5
+        5,                          // rlineto
+        14                          // endchar
+    });
+
+    PathList paths = parseCharstring(cs);
+    ASSERT_EQ(1, paths.size());
+    ASSERT_EQ(2, paths[0].size());
+
+    ASSERT_EQ(LineSegment(Point(500, -500), Point(2500, -498.5)), paths[0][0]);
+    ASSERT_EQ(LineSegment(Point(2500, -498.5), Point(500, -500)), paths[0][1]);
+}
+
+TEST_F(CharstringTest, type2HintsAreSkipped) {
+    Type2Charstring cs({
+        149, 159, 1,                // 10 20 hstem
+        169, 179, 189, 199, 19,     // 30 40 50 60 hintmask (implicit vstem)
+        0xe0,                       // mask for 3 stems
+        129, 129, 21,               // -10 -10 rmoveto
+        159, 7,                     // 20 vlineto
+        159, 6,                     // 20 hlineto
+        119, 7,                     // -20 vlineto
+        119, 6,                     // -20 hlineto
+        14                          // endchar
+    });
+
+    PathList paths = parseCharstring(cs);
+    ASSERT_EQ(1, paths.size());
+    ASSERT_EQ(4, paths[0].size());
+
+    ASSERT_EQ(LineSegment(Point(-10, -10), Point(-10, 10)), paths[0][0]);
+    ASSERT_EQ(LineSegment(Point(10, -10), Point(-10, -10)), paths[0][3]);
+}
+
+TEST_F(CharstringTest, type2MatchesTokens) {
+    Charstring tokens({
+        50, -240, "rmoveto",
+        32, 0, "rlineto",
+        -6, 24, -3, 44, 93, "vvcurveto",
+        113, -70, 48, -98, -52, -59, -13, -35, -55, "vhcurveto",
+        "endchar"
+    });
+
+    Type2Charstring bytes({
+        189, 28, 0xff, 0x10, 21,
+        171, 139, 5,
+        133, 163, 136, 183, 232, 26,
+        247, 5, 69, 187, 41, 87, 80, 126, 104, 84, 30,
+        14
+    });
+
+    PathList paths1 = parseCharstring(tokens);
+    PathList paths2 = parseCharstring(bytes);
+
+    ASSERT_EQ(paths1.size(), paths2.size());
+    ASSERT_EQ(paths1[0].size(), paths2[0].size());
+
+    for (size_t i = 0; i < paths1[0].size(); ++i) {
+        ASSERT_EQ(paths1[0][i], paths2[0][i]);
+    }
+}
+
+TEST_F(CharstringTest, type2Truncated) {
+    Type2Charstring cs({ 129, 129, 21, 28, 0x07 });
+
+    ASSERT_THROW(parseCharstring(cs), ParseError);
+}
+
+TEST_F(CharstringTest, type2EncodeSquare) {
+    Charstring cs({
+        -10, -10, "rmoveto",
+        20, "vlineto",
+        20, "hlineto",
+        -20, "vlineto",
+        -20, "hlineto",
+        "endchar"
+    });
+
+    Type2Charstring bytes;
+    generateCharstring(parseCharstring(cs), bytes);
+
+    Type2Charstring expected({
+        129, 129, 21,                   // -10 -10 rmoveto
+        139, 159, 159, 139, 139, 119, 5, // 0 20 20 0 0 -20 rlineto
+        14                              // endchar
+    });
+
+    ASSERT_EQ(expected, bytes);
+}
+
+TEST_F(CharstringTest, type2EncodeOperands) {
+    Path path;
+    path.append(LineSegment(Point(0, 500), Point(2000, 500)));
+    path.append(LineSegment(Point(2000, 500), Point(2000.5, -500)));
+    path.close();
+
+    PathList paths;
+    paths.push_back(path);
+
+    Type2Charstring bytes;
+    generateCharstring(paths, bytes);
+
+    Type2Charstring expected({
+        248, 136, 4,                    // 500 vmoveto
+        28, 0x07, 0xd0, 139,            // 2000 0
+        255, 0x00, 0x00, 0x80, 0x00,    // 0.5
+        254, 124,                       // -1000
+        5,                              // rlineto
+        14                              // endchar
+    });
+
+    ASSERT_EQ(expected, bytes);
+}
+
+TEST_F(CharstringTest, type2EncodeRoundTrip) {
+    Charstring cs({
+        344, "hmoveto", 65, "hlineto", -6, 24, -3, 44, 93, "vvcurveto", 163, "vlineto",
+        113, -70, 48, -98, -52, -59, -13, -35, -55, "vhcurveto", 28, -52, "rlineto",
+        20, 33, 40, 19, 57, "hhcurveto", 59, 43, -32, -72, "hvcurveto", -30, "vlineto",
+        -4, 181, "rmoveto", -120, "vlineto", -23, -22, -44, -39, -59, "hhcurveto",
+        21, 11, 27, 6, 41, 1.25, "rrcurveto", "endchar"
+    });
+
+    PathList paths1 = parseCharstring(cs);
+
+    Type2Charstring bytes;
+    generateCharstring(paths1, bytes);
+
+    PathList paths2 = parseCharstring(bytes);
+
+    ASSERT_EQ(paths1.size(), paths2.size());
+    for (size_t i = 0; i < paths1.size(); ++i) {
+        ASSERT_EQ(paths1[i].size(), paths2[i].size());
+
+        for (size_t j = 0; j < paths1[i].size(); ++j) {
+            ASSERT_EQ(paths1[i][j], paths2[i][j]);
+        }
+    }
+}
+
+TEST_F(CharstringTest, operatorTokens) {
+    ASSERT_EQ(CsToken(CS_OP_RRCURVETO), CsToken("rrcurveto"));
+    ASSERT_EQ(CsToken(CS_OP_FLEX1), CsToken(std::string("flex1")));
+    ASSERT_NE(CsToken("rlineto"), CsToken("rmoveto"));
+    ASSERT_EQ("hvcurveto", CsToken(CS_OP_HVCURVETO).str());
+
+    CsToken unknown("notanoperator");
+    ASSERT_EQ(PS_OPERATOR, unknown.type);
+    ASSERT_GE(unknown.op, CS_OP_INTERNED);
+    ASSERT_EQ(unknown, CsToken("notanoperator"));
+    ASSERT_EQ("notanoperator", unknown.str());
+}
+
+TEST_F(CharstringTest, manyUnknownOperators) {
+    // Unknown names aren't kept forever, so there is no limit on how many a
+    // process may see
+    for (int i = 0; i < 100000; ++i) {
+        CsToken tok(("unknown" + std::to_string(i)).c_str());
+        ASSERT_GE(tok.op, CS_OP_INTERNED);
+    }
+
+    CsToken unknown("notanoperator");
+    ASSERT_EQ("notanoperator", unknown.str());
+}
+
+TEST_F(CharstringTest, unrecognisedOperator) {
+    Charstring cs({
+        -10, -10, "rmoveto",
+        20, "notanoperator",
+        "endchar"
+    });
+
+    try {
+        parseCharstring(cs);
+        FAIL();
+    }
+    catch (ParseError& ex) {
+        ASSERT_NE(std::string::npos, std::string(ex.what()).find("notanoperator"));
+    }
+}
+
+TEST_F(CharstringTest, parseErrorShowsStack) {
+    Charstring cs({
+        -10, -10, "rmoveto",
+        20, 30, 40, "rlineto",
+        "endchar"
+    });
+
+    try {
+        parseCharstring(cs);
+        FAIL();
+    }
+    catch (ParseError& ex) {
+        ASSERT_NE(std::string::npos, std::string(ex.what()).find("Stack: [20, 30, 40]"));
+    }
+
+    Type2Charstring type2({
+        129, 129, 21,                       // -10 -10 rmoveto
+        159, 169, 179, 5,                   // 20 30 40 rlineto
+        14                                  // endchar
+    });
+
+    try {
+        parseCharstring(type2);
+        FAIL();
+    }
+    catch (ParseError& ex) {
+        ASSERT_NE(std::string::npos, std::string(ex.what()).find("Stack: [20, 30, 40]"));
+    }
+}
+
+TEST_F(CharstringTest, argumentStackLimit) {
+    Charstring cs({ 0, 0, "rmoveto" });
+    for (int i = 0; i < 48; ++i) {
+        cs.push_back(1);
+    }
+    cs.push_back("rlineto");
+
+    ASSERT_EQ(24, parseCharstring(cs)[0].size());
+
+    cs.insert(cs.end() - 1, 1);
+    cs.insert(cs.end() - 1, 1);
+
+    ASSERT_THROW(parseCharstring(cs), ParseError);
+}
+
+// Records parser events, and the control box of the outline
+class RecordingSink {
+    public:
+        RecordingSink()
+            : xMin(1e9), yMin(1e9), xMax(-1e9), yMax(-1e9) {}
+
+        void moveTo(const Point& P) {
+            events << "M" << P;
+            extend(P);
+        }
+
+        void lineTo(const Point& B) {
+            events << "L" << B;
+            extend(B);
+        }
+
+        void curveTo(const Point& B, const Point& C, const Point& D) {
+            events << "C" << B << C << D;
+            extend(B);
+            extend(C);
+            extend(D);
+        }
+
+        void closePath() {
+            events << "Z";
+        }
+
+        std::stringstream events;
+        double xMin, yMin, xMax, yMax;
+
+    private:
+        void extend(const Point& P) {
+            xMin = std::min(xMin, P.x);
+            yMin = std::min(yMin, P.y);
+            xMax = std::max(xMax, P.x);
+            yMax = std::max(yMax, P.y);
+        }
+};
+
+TEST_F(CharstringTest, streamingParse) {
+    Charstring cs({
+        -10, -10, "rmoveto",
+        20, "vlineto",
+        10, 0, 10, 10, 0, 10, "rrcurveto",
+        5, "hmoveto",
+        5, "hmoveto",
+        -20, "hlineto",
+        "endchar"
+    });
+
+    RecordingSink sink;
+    parseCharstring(cs, sink);
+
+    ASSERT_EQ("M(-10, -10)L(-10, 10)C(0, 10)(10, 20)(10, 30)Z"
+              "M(15, 30)M(20, 30)L(0, 30)Z", sink.events.str());
+
+    ASSERT_EQ(-10, sink.xMin);
+    ASSERT_EQ(-10, sink.yMin);
+    ASSERT_EQ(20, sink.xMax);
+    ASSERT_EQ(30, sink.yMax);
+}
+
+TEST_F(CharstringTest, boundingBoxSink) {
+    Charstring cs({
+        -10, -10, "rmoveto",
+        20, "vlineto",
+        10, 0, 10, 10, 0, 10, "rrcurveto",
+        50, "hmoveto",                      // No segments follow
+        -40, "hmoveto",
+        -20, "hlineto",
+        "endchar"
+    });
+
+    BoundingBoxSink sink;
+    parseCharstring(cs, sink);
+
+    ASSERT_EQ(-10, sink.bbox().xmin);
+    ASSERT_EQ(-10, sink.bbox().ymin);
+    ASSERT_EQ(20, sink.bbox().xmax);
+    ASSERT_EQ(30, sink.bbox().ymax);
+
+    // The same box as the parsed outline's
+    Outline outline;
+    parseCharstring(cs, outline);
+
+    BoundingBox box;
+    for (size_t i = 0; i < outline.numContours(); ++i) {
+        box.extend(outline.contour(i).bbox());
+    }
+
+    ASSERT_EQ(box.xmin, sink.bbox().xmin);
+    ASSERT_EQ(box.ymin, sink.bbox().ymin);
+    ASSERT_EQ(box.xmax, sink.bbox().xmax);
+    ASSERT_EQ(box.ymax, sink.bbox().ymax);
+
+    BoundingBoxSink empty;
+    parseCharstring(Charstring({ "endchar" }), empty);
+
+    ASSERT_TRUE(empty.bbox().empty());
+}
+
+TEST_F(CharstringTest, streamingParseType2) {
+    Type2Charstring cs({
+        129, 129, 21,   // -10 -10 rmoveto
+        159, 7,         // 20 vlineto
+        159, 6,         // 20 hlineto
+        14              // endchar
+    });
+
+    RecordingSink sink;
+    parseCharstring(cs, sink);
+
+    ASSERT_EQ("M(-10, -10)L(-10, 10)L(10, 10)Z", sink.events.str());
+}
+
+TEST_F(CharstringTest, outlineRoundTrip) {
+    Type2Charstring cs({
+        129, 129, 21,                       // -10 -10 rmoveto
+        159, 7,                             // 20 vlineto
+        149, 139, 149, 149, 139, 149, 8,    // 10 0 10 10 0 10 rrcurveto
+        14                                  // endchar
+    });
+
+    Outline outline;
+    parseCharstring(cs, outline);
+
+    ASSERT_EQ(1, outline.numContours());
+    ASSERT_EQ(3, outline.verbs().size());
+
+    Type2Charstring out;
+    generateCharstring(outline, out);
+
+    PathList paths1 = parseCharstring(cs);
+    PathList paths2 = parseCharstring(out);
+
+    ASSERT_EQ(paths1.size(), paths2.size());
+    ASSERT_EQ(paths1[0].size(), paths2[0].size());
+
+    for (size_t i = 0; i < paths1[0].size(); ++i) {
+        ASSERT_EQ(paths1[0][i], paths2[0][i]);
+    }
+}
+
+TEST_F(CharstringTest, preparedMerge) {
+    Type2Charstring glyph({
+        39, 39, 21,                         // -100 -100 rmoveto
+        239, 6,                             // 100 hlineto
+        239, 7,                             // 100 vlineto
+        39, 6,                              // -100 hlineto
+        14                                  // endchar
+    });
+
+    Type2Charstring watermark({
+        129, 129, 21,                       // -10 -10 rmoveto
+        159, 6,                             // 20 hlineto
+        159, 7,                             // 20 vlineto
+        14                                  // endchar
+    });
+
+    geometry::PreparedOperand prepared = prepareCharstring(watermark);
+
+    ASSERT_EQ(1, prepared.polygons().size());
+    ASSERT_EQ(-10, prepared.bbox().xmin);
+    ASSERT_EQ(10, prepared.bbox().ymax);
+
+    Type2Charstring merged1;
+    Type2Charstring merged2;
+
+    mergeCharstrings(glyph, watermark, merged1);
+    mergeCharstrings(glyph, prepared, merged2);
+
+    ASSERT_EQ(merged1, merged2);
+}
@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
 #include <Geometry.hpp>
 
 
@@ -52,6 +54,102 @@ TEST_F(GeometryTest, lineSegLineSegEquality) {
     ASSERT_TRUE(L2 == L3);
 }
 
+TEST_F(GeometryTest, pathCopyKeepsCurveTypes) {
+    Path path;
+    path.append(LineSegment(Point(0, 0), Point(10, 0)));
+    path.append(CubicBezier(Point(10, 0), Point(15, 5), Point(15, 10), Point(10, 15)));
+
+    Path cpy(path);
+    path[0].setInitialPoint(Point(1, 1));
+
+    ASSERT_EQ(LineSegment::type, cpy[0].type());
+    ASSERT_EQ(CubicBezier::type, cpy[1].type());
+    ASSERT_EQ(LineSegment(Point(0, 0), Point(10, 0)), cpy[0]);
+
+    struct Counter {
+        int operator()(const LineSegment&) const { return 1; }
+        int operator()(const CubicBezier&) const { return 3; }
+    };
+
+    ASSERT_EQ(1, visitCurve(cpy[0], Counter()));
+    ASSERT_EQ(3, visitCurve(cpy[1], Counter()));
+}
+
+TEST_F(GeometryTest, outlineContours) {
+    Outline outline;
+    outline.moveTo(Point(5, 5));
+    outline.moveTo(Point(0, 0));
+    outline.lineTo(Point(10, 0));
+    outline.curveTo(Point(15, 5), Point(15, 10), Point(10, 15));
+    outline.closePath();
+    outline.moveTo(Point(2, 2));
+    outline.lineTo(Point(4, 2));
+    outline.lineTo(Point(2, 2));
+    outline.closePath();
+
+    ASSERT_EQ(2, outline.numContours());
+
+    Outline::Contour c0 = outline.contour(0);
+    ASSERT_EQ(3, c0.numVerbs);
+    ASSERT_EQ(Outline::LINE, c0.verbs[0]);
+    ASSERT_EQ(Outline::CUBIC, c0.verbs[1]);
+    ASSERT_EQ(Outline::LINE, c0.verbs[2]);
+    ASSERT_EQ(Point(0, 0), c0.initialPoint());
+    ASSERT_TRUE(c0.isClosed());
+
+    Outline::Contour c1 = outline.contour(1);
+    ASSERT_EQ(2, c1.numVerbs);
+    ASSERT_EQ(3, c1.numPoints);
+    ASSERT_EQ(Point(2, 2), c1.initialPoint());
+}
+
+TEST_F(GeometryTest, outlineToPathsAndBack) {
+    Path path;
+    path.append(LineSegment(Point(0, 0), Point(10, 0)));
+    path.append(CubicBezier(Point(10, 0), Point(15, 5), Point(15, 10), Point(10, 15)));
+    path.close();
+
+    PathList paths;
+    paths.push_back(path);
+
+    Outline outline = toOutline(paths);
+    ASSERT_EQ(1, outline.numContours());
+    ASSERT_EQ(3, outline.verbs().size());
+    ASSERT_EQ(6, outline.points().size());
+
+    PathList paths2 = toPathList(outline);
+    ASSERT_EQ(1, paths2.size());
+    ASSERT_EQ(paths[0].size(), paths2[0].size());
+
+    for (size_t i = 0; i < paths[0].size(); ++i) {
+        ASSERT_EQ(paths[0][i], paths2[0][i]);
+    }
+}
+
+TEST_F(GeometryTest, sampleCubicMatchesBernstein) {
+    Point A(0, 0), B(120, 340), C(510, -80), D(600, 250);
+
+    const int n = 37;
+    Point samples[n + 1];
+    sampleCubic(A, B, C, D, n, samples);
+
+    ASSERT_EQ(A, samples[0]);
+    ASSERT_EQ(D, samples[n]);
+
+    for (int i = 0; i <= n; ++i) {
+        double t = static_cast<double>(i) / n;
+        double s = 1.0 - t;
+
+        double b0 = s * s * s;
+        double b1 = 3.0 * s * s * t;
+        double b2 = 3.0 * s * t * t;
+        double b3 = t * t * t;
+
+        ASSERT_NEAR(b0 * A.x + b1 * B.x + b2 * C.x + b3 * D.x, samples[i].x, 1e-9);
+        ASSERT_NEAR(b0 * A.y + b1 * B.y + b2 * C.y + b3 * D.y, samples[i].y, 1e-9);
+    }
+}
+
 #ifdef APPROX_BEZIERS
 TEST_F(GeometryTest, toLinearPaths) {
     Path path;
@@ -73,6 +171,49 @@ TEST_F(GeometryTest, toLinearPaths) {
     ASSERT_EQ(paths1[0][3], paths2[0][3]);
 }
 
+TEST_F(GeometryTest, adaptiveFlattening) {
+    Outline outline;
+    outline.moveTo(Point(0, 0));
+    outline.curveTo(Point(10, 0), Point(20, 0), Point(30, 0));  // Flat
+    outline.curveTo(Point(30, 50), Point(0, 50), Point(0, 0));   // Tight
+    outline.curveTo(Point(0, 0.1), Point(0.1, 0.1), Point(0.1, 0));  // Tiny
+
+    FLATTENING_TOLERANCE = 0.5;
+    Outline linear = approx::toLinearOutline(outline);
+    FLATTENING_TOLERANCE = 0;
+
+    const std::vector<Outline::Verb>& verbs = linear.verbs();
+    ASSERT_TRUE(std::all_of(verbs.begin(), verbs.end(), [](Outline::Verb v) { return v == Outline::LINE; }));
+
+    // One segment each for the flat and tiny curves
+    const std::vector<Point>& points = linear.points();
+    ASSERT_LT(3, verbs.size());
+    ASSERT_EQ(Point(30, 0), points[1]);
+    ASSERT_EQ(Point(0, 0), points[points.size() - 2]);
+
+    // The tight curve stays within tolerance of its polyline
+    for (int i = 0; i <= 100; ++i) {
+        double t = i / 100.0;
+        double s = 1.0 - t;
+        Point P(3 * s * s * t * 30 + 3 * s * t * t * 0, 3 * s * s * t * 50 + 3 * s * t * t * 50);
+        P = P + Point(s * s * s * 30, 0);
+
+        double best = 1e9;
+        for (size_t j = 1; j + 2 < points.size(); ++j) {
+            Point AB = points[j + 1] - points[j];
+            Point AP = P - points[j];
+            double u = std::max(0.0, std::min(1.0, (AP.x * AB.x + AP.y * AB.y) / (AB.x * AB.x + AB.y * AB.y)));
+            best = std::min(best, hypot(AP.x - u * AB.x, AP.y - u * AB.y));
+        }
+
+        ASSERT_GE(0.5, best);
+    }
+
+    setRelativeFlatteningTolerance(0.001, 1000);
+    ASSERT_EQ(1.0, FLATTENING_TOLERANCE);
+    FLATTENING_TOLERANCE = 0;
+}
+
 TEST_F(GeometryTest, pathsToPoly) {
     Path path;
     path.append(LineSegment(Point(-10, -10), Point(10, -10)));
@@ -122,6 +263,389 @@ TEST_F(GeometryTest, pathsToPolyAndBack) {
         ASSERT_EQ(paths1[0][i], paths2[0][i]);
     }
 }
+
+static void appendRect(Outline& outline, double x0, double y0, double x1, double y1) {
+    outline.moveTo(Point(x0, y0));
+    outline.lineTo(Point(x1, y0));
+    outline.lineTo(Point(x1, y1));
+    outline.lineTo(Point(x0, y1));
+    outline.closePath();
+}
+
+static double signedArea(const Outline& linear) {
+    double area = 0.0;
+
+    for (size_t i = 0; i < linear.numContours(); ++i) {
+        Outline::Contour contour = linear.contour(i);
+
+        for (size_t j = 0; j < contour.numVerbs; ++j) {
+            const Point& A = contour.points[j];
+            const Point& B = contour.points[j + 1];
+
+            area += 0.5 * (A.x * B.y - B.x * A.y);
+        }
+    }
+
+    return area;
+}
+
+static int windingNumber(const Outline& linear, const Point& P) {
+    int w = 0;
+
+    for (size_t i = 0; i < linear.numContours(); ++i) {
+        Outline::Contour contour = linear.contour(i);
+
+        for (size_t j = 0; j < contour.numVerbs; ++j) {
+            const Point& A = contour.points[j];
+            const Point& B = contour.points[j + 1];
+
+            if ((A.y > P.y) != (B.y > P.y) && P.x < A.x + (P.y - A.y) * (B.x - A.x) / (B.y - A.y)) {
+                w += B.y > A.y ? 1 : -1;
+            }
+        }
+    }
+
+    return w;
+}
+
+TEST_F(GeometryTest, nativeUnion) {
+    Outline outline1;
+    appendRect(outline1, 0, 0, 10, 10);
+
+    Outline outline2;
+    appendRect(outline2, 5, 5, 15, 15);
+    appendRect(outline2, 10, 0, 12, 2);    // Shares an edge with outline1
+    appendRect(outline2, 15, 15, 20, 20);  // Touches outline2 at a corner
+
+    Outline result;
+    ASSERT_TRUE(approx::nativeUnion(outline1, outline2, result));
+
+    ASSERT_EQ(2, result.numContours());
+    ASSERT_NEAR(175 + 4 + 25, signedArea(result), 1e-9);
+
+    // The corner-to-corner square stays separate
+    Outline::Contour c0 = result.contour(0);
+    Outline::Contour c1 = result.contour(1);
+    ASSERT_EQ(10, c0.numVerbs);
+    ASSERT_EQ(4, c1.numVerbs);
+    ASSERT_TRUE(c0.isClosed());
+    ASSERT_TRUE(c1.isClosed());
+}
+
+TEST_F(GeometryTest, nativeUnionWithHoles) {
+    Outline outline1;
+    appendRect(outline1, 0, 0, 30, 30);
+    outline1.moveTo(Point(10, 10));    // Clockwise hole
+    outline1.lineTo(Point(10, 20));
+    outline1.lineTo(Point(20, 20));
+    outline1.lineTo(Point(20, 10));
+    outline1.closePath();
+
+    Outline outline2;
+    appendRect(outline2, 12, 12, 14, 14);  // Island in the hole
+    appendRect(outline2, 0, 0, 30, 5);     // Runs along the outer boundary
+
+    Outline result;
+    ASSERT_TRUE(approx::nativeUnion(outline1, outline2, result));
+
+    ASSERT_EQ(3, result.numContours());
+    ASSERT_NEAR(900 - 100 + 4, signedArea(result), 1e-9);
+
+    ASSERT_EQ(1, windingNumber(result, Point(5, 5)));
+    ASSERT_EQ(0, windingNumber(result, Point(11, 11)));
+    ASSERT_EQ(1, windingNumber(result, Point(13, 13)));
+}
+
+TEST_F(GeometryTest, nativeUnionMatchesCgal) {
+    Outline outline1;
+    outline1.moveTo(Point(0, 0));
+    outline1.lineTo(Point(100, 0));
+    outline1.curveTo(Point(140, 30), Point(140, 70), Point(100, 100));
+    outline1.lineTo(Point(0, 100));
+    outline1.closePath();
+    outline1.moveTo(Point(30, 30));
+    outline1.lineTo(Point(30, 70));
+    outline1.lineTo(Point(70, 70));
+    outline1.lineTo(Point(70, 30));
+    outline1.closePath();
+
+    Outline outline2;
+    outline2.moveTo(Point(50, -20));
+    outline2.curveTo(Point(90, 20), Point(170, 40), Point(110, 130));
+    outline2.lineTo(Point(45, 50));
+    outline2.closePath();
+
+    Outline linear1 = approx::toLinearOutline(outline1);
+    Outline linear2 = approx::toLinearOutline(outline2);
+
+    Outline native;
+    ASSERT_TRUE(approx::nativeUnion(linear1, linear2, native));
+
+    Outline cgal = approx::computeUnion(outline1, outline2);
+
+    ASSERT_NEAR(signedArea(cgal), signedArea(native), 1e-6);
+
+    for (double y = -25.5; y < 135; y += 3) {
+        for (double x = -5.5; x < 175; x += 3) {
+            Point P(x, y);
+            bool inside = windingNumber(linear1, P) != 0 || windingNumber(linear2, P) != 0;
+
+            ASSERT_EQ(inside, windingNumber(native, P) != 0);
+            ASSERT_EQ(inside, windingNumber(cgal, P) != 0);
+        }
+    }
+}
+
+TEST_F(GeometryTest, fastKernelMatchesExact) {
+    Outline outline1;
+    outline1.moveTo(Point(0.1, 0.1));
+    outline1.lineTo(Point(10.3, 0.1));
+    outline1.lineTo(Point(10.3, 10.7));
+    outline1.lineTo(Point(0.1, 10.7));
+    outline1.closePath();
+
+    Outline outline2;
+    outline2.moveTo(Point(5.5, 5.5));
+    outline2.lineTo(Point(15.25, 5.5));
+    outline2.lineTo(Point(15.25, 15.9));
+    outline2.lineTo(Point(5.5, 15.9));
+    outline2.closePath();
+
+    approx::cgal_approx::PolyList polyList1 = approx::toPolyList(outline1);
+    approx::cgal_approx::PolyList polyList2 = approx::toPolyList(outline2);
+
+    Outline fast;
+    ASSERT_TRUE(approx::fastJoin(polyList1, polyList2, fast));
+
+    // Every vertex lies on the 16.16 grid
+    for (const Point& P : fast.points()) {
+        ASSERT_EQ(P.x * 65536.0, std::round(P.x * 65536.0));
+        ASSERT_EQ(P.y * 65536.0, std::round(P.y * 65536.0));
+    }
+
+    Outline exact = approx::joinPolyLists(polyList1, polyList2);
+
+    approx::USE_FAST_KERNEL = true;
+    Outline viaPolicy = approx::joinPolyLists(polyList1, polyList2);
+    approx::USE_FAST_KERNEL = false;
+
+    ASSERT_EQ(exact.numContours(), fast.numContours());
+    ASSERT_EQ(exact.points().size(), fast.points().size());
+    ASSERT_EQ(fast.points().size(), viaPolicy.points().size());
+
+    for (size_t i = 0; i < exact.points().size(); ++i) {
+        ASSERT_EQ(exact.points()[i], fast.points()[i]);
+        ASSERT_EQ(fast.points()[i], viaPolicy.points()[i]);
+    }
+}
+
+TEST_F(GeometryTest, fastKernelFallsBackToExact) {
+    Outline outline1;
+    outline1.moveTo(Point(0, 0));
+    outline1.lineTo(Point(10, 0));
+    outline1.lineTo(Point(10, 10));
+    outline1.lineTo(Point(0, 10));
+    outline1.closePath();
+
+    // Thinner than the 16.16 grid, so it snaps to nothing
+    Outline outline2;
+    outline2.moveTo(Point(20, 0));
+    outline2.lineTo(Point(30, 0));
+    outline2.lineTo(Point(30, 0.000001));
+    outline2.lineTo(Point(20, 0.000001));
+    outline2.closePath();
+
+    approx::cgal_approx::PolyList polyList1 = approx::toPolyList(outline1);
+    approx::cgal_approx::PolyList polyList2 = approx::toPolyList(outline2);
+
+    Outline fast;
+    ASSERT_FALSE(approx::fastJoin(polyList1, polyList2, fast));
+    ASSERT_TRUE(fast.empty());
+
+    Outline exact = approx::joinPolyLists(polyList1, polyList2);
+
+    approx::USE_FAST_KERNEL = true;
+    Outline viaPolicy = approx::joinPolyLists(polyList1, polyList2);
+    approx::USE_FAST_KERNEL = false;
+
+    ASSERT_EQ(2, viaPolicy.numContours());
+    ASSERT_EQ(exact.verbs(), viaPolicy.verbs());
+    ASSERT_EQ(exact.points().size(), viaPolicy.points().size());
+
+    for (size_t i = 0; i < exact.points().size(); ++i) {
+        ASSERT_EQ(exact.points()[i].x, viaPolicy.points()[i].x);
+        ASSERT_EQ(exact.points()[i].y, viaPolicy.points()[i].y);
+    }
+}
+
+TEST_F(GeometryTest, fastKernelKeepsNestedPolygons) {
+    // A counter with an island in it, and a separate square
+    Outline outline1;
+    appendRect(outline1, 0, 0, 100, 100);
+    outline1.moveTo(Point(20, 20));
+    outline1.lineTo(Point(20, 80));
+    outline1.lineTo(Point(80, 80));
+    outline1.lineTo(Point(80, 20));
+    outline1.closePath();
+
+    Outline outline2;
+    appendRect(outline2, 40, 40, 60, 60);
+    appendRect(outline2, 200, 0, 210, 10);
+
+    approx::cgal_approx::PolyList polyList1 = approx::toPolyList(outline1);
+    approx::cgal_approx::PolyList polyList2 = approx::toPolyList(outline2);
+
+    // Polygons that touch nothing, or sit in a hole, pass the checks
+    Outline fast;
+    ASSERT_TRUE(approx::fastJoin(polyList1, polyList2, fast));
+    ASSERT_EQ(4, fast.numContours());
+}
+
+static void appendClockwiseRect(Outline& outline, double x0, double y0, double x1, double y1) {
+    outline.moveTo(Point(x0, y0));
+    outline.lineTo(Point(x0, y1));
+    outline.lineTo(Point(x1, y1));
+    outline.lineTo(Point(x1, y0));
+    outline.closePath();
+}
+
+TEST_F(GeometryTest, nestedContoursToPoly) {
+    Outline outline;
+    appendClockwiseRect(outline, 12, 12, 18, 18);  // Hole of the island
+    appendRect(outline, 0, 0, 50, 50);
+    appendClockwiseRect(outline, 10, 10, 40, 40);
+    appendRect(outline, 11, 11, 20, 20);           // Island in the hole
+    appendClockwiseRect(outline, 60, 60, 70, 70);  // Inside nothing
+    appendRect(outline, 100, 0, 110, 10);
+    appendClockwiseRect(outline, 102, 2, 104, 4);
+
+    approx::cgal_approx::PolyList polyList = approx::toPolyList(outline);
+    ASSERT_EQ(3, polyList.size());
+
+    // Outer boundaries keep their order, each with its own holes
+    ASSERT_EQ(50, CGAL::to_double(polyList[0].outer_boundary()[2].x()));
+    ASSERT_EQ(20, CGAL::to_double(polyList[1].outer_boundary()[2].x()));
+    ASSERT_EQ(110, CGAL::to_double(polyList[2].outer_boundary()[2].x()));
+
+    ASSERT_EQ(1, polyList[0].number_of_holes());
+    ASSERT_EQ(1, polyList[1].number_of_holes());
+    ASSERT_EQ(1, polyList[2].number_of_holes());
+
+    ASSERT_EQ(10, CGAL::to_double(polyList[0].holes_begin()->vertex(0).x()));
+    ASSERT_EQ(12, CGAL::to_double(polyList[1].holes_begin()->vertex(0).x()));
+    ASSERT_EQ(102, CGAL::to_double(polyList[2].holes_begin()->vertex(0).x()));
+}
+
+static Point bezierPoint(const Point* P, double t) {
+    double s = 1.0 - t;
+    double w[4] = { s * s * s, 3 * s * s * t, 3 * s * t * t, t * t * t };
+
+    return Point(w[0] * P[0].x + w[1] * P[1].x + w[2] * P[2].x + w[3] * P[3].x,
+        w[0] * P[0].y + w[1] * P[1].y + w[2] * P[2].y + w[3] * P[3].y);
+}
+
+TEST_F(GeometryTest, restoreCurves) {
+    Outline source;
+    source.moveTo(Point(0, 0));
+    source.lineTo(Point(100, 0));
+    source.curveTo(Point(100, 50), Point(50, 100), Point(0, 100));
+    source.closePath();
+
+    Outline linear = approx::toLinearOutline(source);
+    ASSERT_EQ(13, linear.points().size());
+
+    // Untouched, the original curve comes back
+    Outline restored = approx::restoreCurves(linear, source);
+    ASSERT_EQ(source.verbs(), restored.verbs());
+
+    for (size_t i = 0; i < source.points().size(); ++i) {
+        ASSERT_EQ(source.points()[i].x, restored.points()[i].x);
+        ASSERT_EQ(source.points()[i].y, restored.points()[i].y);
+    }
+
+    // Cut the curve with an intersection vertex, leaving samples 0-3 and 6-10
+    const std::vector<Point>& points = linear.points();
+
+    Outline cut;
+    cut.moveTo(points[0]);
+
+    for (size_t i = 1; i < points.size(); ++i) {
+        if (i == 5) {
+            cut.lineTo(Point(40, 40));
+        }
+        else if (i < 5 || i > 6) {
+            cut.lineTo(points[i]);
+        }
+    }
+
+    restored = approx::restoreCurves(cut, source);
+
+    std::vector<Outline::Verb> verbs = {
+        Outline::LINE, Outline::CUBIC, Outline::LINE, Outline::LINE, Outline::CUBIC, Outline::LINE
+    };
+    ASSERT_EQ(verbs, restored.verbs());
+
+    const Point* ctrl = source.points().data() + 1;
+    const Point* head = restored.points().data() + 1;
+    const Point* tail = restored.points().data() + 6;
+
+    ASSERT_EQ(points[4].x, head[3].x);
+    ASSERT_EQ(points[7].x, tail[0].x);
+
+    for (int i = 0; i <= 10; ++i) {
+        double t = i / 10.0;
+
+        ASSERT_EQ(bezierPoint(ctrl, 0.3 * t), bezierPoint(head, t));
+        ASSERT_EQ(bezierPoint(ctrl, 0.6 + 0.4 * t), bezierPoint(tail, t));
+    }
+}
+
+TEST_F(GeometryTest, fitCurves) {
+    Outline circle;
+    circle.moveTo(Point(0, 50));
+    circle.curveTo(Point(0, 78), Point(22, 100), Point(50, 100));
+    circle.curveTo(Point(78, 100), Point(100, 78), Point(100, 50));
+    circle.curveTo(Point(100, 22), Point(78, 0), Point(50, 0));
+    circle.curveTo(Point(22, 0), Point(0, 22), Point(0, 50));
+
+    Outline linear = approx::toLinearOutline(circle);
+    appendRect(linear, 200, 0, 300, 100);
+
+    Outline fitted = approx::fitCurves(linear, 0.1);
+    ASSERT_EQ(2, fitted.numContours());
+
+    // The rectangle's corners are kept
+    Outline::Contour rect = fitted.contour(1);
+    ASSERT_EQ(4, rect.numVerbs);
+    ASSERT_EQ(Point(200, 0), rect.points[0]);
+    ASSERT_EQ(Point(300, 0), rect.points[1]);
+    ASSERT_EQ(Point(300, 100), rect.points[2]);
+    ASSERT_EQ(Point(200, 100), rect.points[3]);
+
+    // The circle needs far fewer cubics than it had segments, and passes
+    // within tolerance of every vertex
+    Outline::Contour round = fitted.contour(0);
+    ASSERT_GE(8, round.numVerbs);
+    ASSERT_TRUE(std::all_of(round.verbs, round.verbs + round.numVerbs,
+        [](Outline::Verb v) { return v == Outline::CUBIC; }));
+
+    const Point* ctrl = round.points;
+    Outline::Contour polyline = linear.contour(0);
+
+    for (size_t i = 0; i < polyline.numPoints; ++i) {
+        const Point& P = polyline.points[i];
+        double best = 1e9;
+
+        for (size_t j = 0; j < round.numVerbs; ++j) {
+            for (int k = 0; k <= 2000; ++k) {
+                Point Q = bezierPoint(ctrl + 3 * j, k / 2000.0) - P;
+                best = std::min(best, hypot(Q.x, Q.y));
+            }
+        }
+
+        ASSERT_GE(0.1, best);
+    }
+}
 #endif
 
 #ifndef APPROX_BEZIERS
@@ -400,6 +924,180 @@ TEST_F(GeometryTest, pathsToPolyWithBezier) {
     }
     //------------------
 }
+
+TEST_F(GeometryTest, xMonoSectionInDoubles) {
+    Path path;
+    path.append(LineSegment(Point(-10, -10), Point(10, -10)));
+    path.append(CubicBezier(Point(10, -10), Point(7, -4), Point(13, 3), Point(10, 10)));
+    path.append(LineSegment(Point(10, 10), Point(-10, 10)));
+    path.append(CubicBezier(Point(-10, 10), Point(-20, 5), Point(0, -5), Point(-10, -10)));
+
+    PathList paths;
+    paths.push_back(path);
+
+    cgal_wrap::PolyList polyList = toPolyList(paths);
+    ASSERT_EQ(1, polyList.size());
+
+    const cgal_wrap::BezierPolygon& outer = polyList[0].outer_boundary();
+
+    // The double precision subdivision agrees with the exact one
+    for (auto it = outer.curves_begin(); it != outer.curves_end(); ++it) {
+        cgal_wrap::BezierCurve exact = cubicBezierFromXMonoSection(*it);
+
+        Point ctrl[4];
+        size_t n = controlPointsOfXMonoSection(*it, ctrl);
+        ASSERT_EQ(exact.number_of_control_points(), n);
+
+        for (size_t i = 0; i < n; ++i) {
+            Point P = exact.control_point(i);
+
+            ASSERT_NEAR(P.x, ctrl[i].x, 1e-9);
+            ASSERT_NEAR(P.y, ctrl[i].y, 1e-9);
+        }
+    }
+}
+
+TEST_F(GeometryTest, linearEngineMatchesCurveEngine) {
+    Outline outline1;
+    outline1.moveTo(Point(0.5, 0.25));
+    outline1.lineTo(Point(10.75, 0.25));
+    outline1.lineTo(Point(10.75, 10.5));
+    outline1.lineTo(Point(0.5, 10.5));
+    outline1.closePath();
+
+    Outline outline2;
+    outline2.moveTo(Point(5.125, 5.5));
+    outline2.lineTo(Point(15.25, 5.5));
+    outline2.lineTo(Point(15.25, 15.875));
+    outline2.lineTo(Point(5.125, 15.875));
+    outline2.closePath();
+
+    USE_LINEAR_ENGINE = true;
+    Outline linear = computeUnion(outline1, outline2);
+    USE_LINEAR_ENGINE = false;
+
+    Outline curved = computeUnion(outline1, outline2);
+
+    ASSERT_EQ(1, linear.numContours());
+    ASSERT_EQ(curved.numContours(), linear.numContours());
+
+    // The engines may start the contour at different vertices
+    std::vector<Point> linearPoints(linear.points().begin(), linear.points().end());
+    std::vector<Point> curvedPoints(curved.points().begin(), curved.points().end());
+    ASSERT_EQ(curvedPoints.size(), linearPoints.size());
+
+    auto lessPoint = [](const Point& a, const Point& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    };
+
+    std::sort(linearPoints.begin(), linearPoints.end(), lessPoint);
+    std::sort(curvedPoints.begin(), curvedPoints.end(), lessPoint);
+
+    for (size_t i = 0; i < linearPoints.size(); ++i) {
+        ASSERT_EQ(curvedPoints[i], linearPoints[i]);
+    }
+}
+
+TEST_F(GeometryTest, linearEngineIgnoresApproxSettings) {
+    Outline outline1;
+    outline1.moveTo(Point(0, 0));
+    outline1.lineTo(Point(10, 0));
+    outline1.lineTo(Point(10, 10));
+    outline1.lineTo(Point(0, 10));
+    outline1.closePath();
+
+    Outline outline2;
+    outline2.moveTo(Point(5, 5));
+    outline2.lineTo(Point(15, 5));
+    outline2.lineTo(Point(15, 15));
+    outline2.lineTo(Point(5, 15));
+    outline2.closePath();
+
+    USE_LINEAR_ENGINE = true;
+    Outline exact = computeUnion(outline1, outline2);
+
+    approx::USE_NATIVE_CLIPPER = true;
+    Outline native = computeUnion(outline1, outline2);
+    approx::USE_NATIVE_CLIPPER = false;
+
+    approx::USE_FAST_KERNEL = true;
+    Outline fast = computeUnion(outline1, outline2);
+    approx::USE_FAST_KERNEL = false;
+
+    ASSERT_EQ(exact.verbs(), native.verbs());
+    ASSERT_EQ(exact.verbs(), fast.verbs());
+    ASSERT_EQ(exact.points().size(), native.points().size());
+    ASSERT_EQ(exact.points().size(), fast.points().size());
+
+    for (size_t i = 0; i < exact.points().size(); ++i) {
+        ASSERT_EQ(exact.points()[i].x, native.points()[i].x);
+        ASSERT_EQ(exact.points()[i].y, native.points()[i].y);
+        ASSERT_EQ(exact.points()[i].x, fast.points()[i].x);
+        ASSERT_EQ(exact.points()[i].y, fast.points()[i].y);
+    }
+
+    // A hole with no outer boundary is rejected, as by the Bezier engine
+    Outline hole;
+    hole.moveTo(Point(5, 5));
+    hole.lineTo(Point(5, 15));
+    hole.lineTo(Point(15, 15));
+    hole.lineTo(Point(15, 5));
+    hole.closePath();
+
+    ASSERT_THROW(computeUnion(outline1, hole), GeometryException);
+
+    USE_LINEAR_ENGINE = false;
+    ASSERT_THROW(computeUnion(outline1, hole), GeometryException);
+}
+
+TEST_F(GeometryTest, linearEngineKeepsCurves) {
+    // A rounded corner, whose control box nothing else reaches into
+    Outline outline1;
+    outline1.moveTo(Point(0, 0));
+    outline1.lineTo(Point(10, 0));
+    outline1.curveTo(Point(15.5, 0), Point(20, 4.5), Point(20, 10));
+    outline1.lineTo(Point(0, 10));
+    outline1.closePath();
+
+    Outline outline2;
+    outline2.moveTo(Point(-5, 5));
+    outline2.lineTo(Point(5, 5));
+    outline2.lineTo(Point(5, 15));
+    outline2.lineTo(Point(-5, 15));
+    outline2.closePath();
+
+    USE_LINEAR_ENGINE = true;
+    Outline joined = computeUnion(outline1, outline2);
+    USE_LINEAR_ENGINE = false;
+
+    ASSERT_EQ(1, joined.numContours());
+    ASSERT_EQ(1, std::count(joined.verbs().begin(), joined.verbs().end(), Outline::CUBIC));
+
+    const std::vector<Point>& points = joined.points();
+    auto ctrl = std::find(points.begin(), points.end(), Point(15.5, 0));
+    ASSERT_TRUE(ctrl != points.begin() && ctrl + 2 < points.end());
+    ASSERT_EQ(Point(10, 0), ctrl[-1]);
+    ASSERT_EQ(Point(20, 4.5), ctrl[1]);
+    ASSERT_EQ(Point(20, 10), ctrl[2]);
+
+    // Reaching into the curve's control box sends the union to the Bezier
+    // engine
+    Outline outline3;
+    outline3.moveTo(Point(15, 5));
+    outline3.lineTo(Point(25, 5));
+    outline3.lineTo(Point(25, 15));
+    outline3.lineTo(Point(15, 15));
+    outline3.closePath();
+
+    USE_LINEAR_ENGINE = true;
+    Outline linear = computeUnion(outline1, outline3);
+    USE_LINEAR_ENGINE = false;
+
+    Outline curved = computeUnion(outline1, outline3);
+
+    ASSERT_EQ(curved.verbs(), linear.verbs());
+    ASSERT_EQ(curved.points(), linear.points());
+}
 #endif
 
 TEST_F(GeometryTest, pathsToPolyAndBackWithBezier) {
@@ -417,13 +1115,11 @@ TEST_F(GeometryTest, pathsToPolyAndBackWithBezier) {
 
     PathList paths2 = toPathList(polyList);
     ASSERT_EQ(1, paths2.size());
-    ASSERT_EQ(6, paths2[0].size()); // The bezier should have been split into 3 x-monotone curves
+    ASSERT_EQ(4, paths2[0].size()); // The bezier's 3 x-monotone pieces are merged back together
 
-    ASSERT_EQ(paths1[0][0], paths2[0][0]);
-    ASSERT_EQ(paths1[0][1].initialPoint(), paths2[0][1].initialPoint());
-    ASSERT_EQ(paths1[0][1].finalPoint(), paths2[0][3].finalPoint());
-    ASSERT_EQ(paths1[0][2], paths2[0][4]);
-    ASSERT_EQ(paths1[0][3], paths2[0][5]);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(paths1[0][i], paths2[0][i]);
+    }
 }
 
 TEST_F(GeometryTest, pathsToPolyAndBackWithHole) {
@@ -704,3 +1400,327 @@ TEST_F(GeometryTest, bezierPathsWithHolesUnion) {
     ASSERT_EQ(LineSegment(Point(5, 0), Point(0, 0)), paths3[1][2]);
     ASSERT_EQ(LineSegment(Point(0, 0), Point(0, 5)), paths3[1][3]);*/
 }
+
+static Outline bezierSquare(double x, double y, double size) {
+    Outline outline;
+    outline.moveTo(Point(x, y));
+    outline.lineTo(Point(x + size, y));
+    outline.curveTo(Point(x + size + 2, y + 2), Point(x + size + 2, y + size - 2), Point(x + size, y + size));
+    outline.lineTo(Point(x, y + size));
+    outline.closePath();
+
+    return outline;
+}
+
+static bool sameContour(const Outline::Contour& a, const Outline::Contour& b) {
+    if (a.numVerbs != b.numVerbs || a.numPoints != b.numPoints) {
+        return false;
+    }
+
+    return std::equal(a.verbs, a.verbs + a.numVerbs, b.verbs)
+        && std::equal(a.points, a.points + a.numPoints, b.points);
+}
+
+TEST_F(GeometryTest, boundingBoxOverlap) {
+    Outline outline = bezierSquare(0, 0, 10);
+    BoundingBox box = outline.contour(0).bbox();
+
+    ASSERT_EQ(0, box.xmin);
+    ASSERT_EQ(0, box.ymin);
+    ASSERT_EQ(12, box.xmax);
+    ASSERT_EQ(10, box.ymax);
+
+    ASSERT_TRUE(box.overlaps(bezierSquare(12, 5, 1).contour(0).bbox()));
+    ASSERT_FALSE(box.overlaps(bezierSquare(12.1, 5, 1).contour(0).bbox()));
+    ASSERT_FALSE(box.overlaps(BoundingBox()));
+}
+
+TEST_F(GeometryTest, simplify) {
+    Outline outline;
+    outline.moveTo(Point(0, 0));
+    outline.lineTo(Point(10, 0.01));
+    outline.lineTo(Point(20, 0));
+    outline.lineTo(Point(20, 0));
+    outline.lineTo(Point(30, 0));
+    outline.lineTo(Point(30, 10));
+    outline.curveTo(Point(20, 20), Point(10, 20), Point(0, 10));
+    outline.lineTo(Point(0, 5));
+    outline.closePath();
+
+    size_t removed = 0;
+    Outline simplified = simplify(outline, 0.1, removed);
+    ASSERT_EQ(4, removed);
+
+    // Started at the curve, which is kept as it was
+    std::vector<Outline::Verb> verbs = { Outline::CUBIC, Outline::LINE, Outline::LINE, Outline::LINE };
+    ASSERT_EQ(verbs, simplified.verbs());
+
+    std::vector<Point> points = {
+        Point(30, 10), Point(20, 20), Point(10, 20), Point(0, 10), Point(0, 0), Point(30, 0), Point(30, 10)
+    };
+    ASSERT_EQ(points, simplified.points());
+
+    // A sliver thinner than the tolerance is left alone
+    Outline sliver;
+    sliver.moveTo(Point(0, 0));
+    sliver.lineTo(Point(10, 0.01));
+    sliver.lineTo(Point(20, 0));
+    sliver.closePath();
+
+    simplified = simplify(sliver, 0.1, removed);
+    ASSERT_EQ(0, removed);
+    ASSERT_EQ(sliver.points(), simplified.points());
+}
+
+TEST_F(GeometryTest, simplifyStats) {
+    Outline outline;
+    outline.moveTo(Point(0, 0));
+    outline.lineTo(Point(10, 0.01));
+    outline.lineTo(Point(20, 0));
+    outline.lineTo(Point(20, 10));
+    outline.lineTo(Point(0, 10));
+    outline.closePath();
+
+    simplifyStats() = SimplifyStats();
+
+    SIMPLIFY_INPUT_TOLERANCE = 0.1;
+    SIMPLIFY_OUTPUT_TOLERANCE = 0.001;
+
+    Outline input = simplifyInput(outline);
+    Outline output = simplifyOutput(outline);
+    simplifyInput(outline);
+
+    SIMPLIFY_INPUT_TOLERANCE = 0;
+    SIMPLIFY_OUTPUT_TOLERANCE = 0;
+
+    ASSERT_EQ(5, input.points().size());
+    ASSERT_EQ(6, output.points().size());
+
+    // The counts add up over calls
+    ASSERT_EQ(2, simplifyStats().inputVerticesRemoved);
+    ASSERT_EQ(0, simplifyStats().outputVerticesRemoved);
+}
+
+TEST_F(GeometryTest, normalise) {
+    Outline outline;
+    outline.moveTo(Point(0, 0));
+    outline.lineTo(Point(10, 0));
+    outline.lineTo(Point(10, 0.000001));                              // Repeated point
+    outline.curveTo(Point(10, 3), Point(10, 6), Point(10, 10));       // Straight
+    outline.curveTo(Point(10, 10), Point(10, 10), Point(10, 10));     // No length
+    outline.curveTo(Point(5, 15), Point(0, 15), Point(0, 10));
+    outline.lineTo(Point(0.000001, 0));                               // Back to the start
+    outline.lineTo(Point(0, 0));
+
+    outline.moveTo(Point(50, 50));                                    // Nothing left
+    outline.lineTo(Point(50, 50));
+
+    Outline normalised = normalise(outline);
+    ASSERT_EQ(1, normalised.numContours());
+
+    std::vector<Outline::Verb> verbs = { Outline::LINE, Outline::LINE, Outline::CUBIC, Outline::LINE };
+    ASSERT_EQ(verbs, normalised.verbs());
+
+    const std::vector<Point>& points = normalised.points();
+    ASSERT_EQ(7, points.size());
+    ASSERT_EQ(Point(10, 10), points[2]);
+    ASSERT_EQ(Point(0, 10), points[5]);
+
+    // The contour closes exactly
+    ASSERT_EQ(0.0, points[6].x);
+    ASSERT_EQ(0.0, points[6].y);
+
+    // Neither tolerance follows FLOAT_PRECISION
+    Outline small;
+    small.moveTo(Point(0, 0));
+    small.lineTo(Point(1, 0));
+    small.curveTo(Point(1, 0.25), Point(0.5, 1), Point(0, 1));
+    small.closePath();
+
+    double floatPrecision = FLOAT_PRECISION;
+    FLOAT_PRECISION = 20.0;
+    normalised = normalise(small);
+    FLOAT_PRECISION = floatPrecision;
+
+    ASSERT_EQ(small.verbs(), normalised.verbs());
+    ASSERT_EQ(small.points().size(), normalised.points().size());
+}
+
+TEST_F(GeometryTest, signedArea) {
+    Outline rect;
+    rect.moveTo(Point(0, 0));
+    rect.lineTo(Point(10, 0));
+    rect.lineTo(Point(10, 5));
+    rect.lineTo(Point(0, 5));
+    rect.closePath();
+
+    rect.moveTo(Point(0, 0));
+    rect.lineTo(Point(0, 5));
+    rect.lineTo(Point(10, 5));
+    rect.lineTo(Point(10, 0));
+    rect.closePath();
+
+    ASSERT_DOUBLE_EQ(50.0, signedArea(rect.contour(0)));
+    ASSERT_DOUBLE_EQ(-50.0, signedArea(rect.contour(1)));
+
+    // Against the area of the finely flattened curve
+    Outline outline = bezierSquare(0, 0, 10);
+    const Point* ctrl = &outline.points()[1];
+
+    std::vector<Point> samples(1001);
+    sampleCubic(ctrl[0], ctrl[1], ctrl[2], ctrl[3], 1000, samples.data());
+    samples.push_back(Point(0, 10));
+    samples.push_back(Point(0, 0));
+
+    double flattened = 0.0;
+
+    for (size_t i = 1; i < samples.size(); ++i) {
+        flattened += (samples[i - 1].x * samples[i].y - samples[i].x * samples[i - 1].y) / 2.0;
+    }
+
+    double area = signedArea(outline.contour(0));
+    ASSERT_NEAR(flattened, area, 1e-4);
+
+    // Unaffected by distance from the origin
+    Outline distant = bezierSquare(100000, -100000, 10);
+    ASSERT_NEAR(area, signedArea(distant.contour(0)), 1e-9);
+}
+
+TEST_F(GeometryTest, disjointUnionSkipsEngine) {
+    Outline outline1 = bezierSquare(0, 0, 10);
+    Outline outline2 = bezierSquare(100, 100, 10);
+
+    Outline outline3 = computeUnion(outline1, outline2);
+
+    ASSERT_EQ(2, outline3.numContours());
+    ASSERT_TRUE(sameContour(outline1.contour(0), outline3.contour(0)));
+    ASSERT_TRUE(sameContour(outline2.contour(0), outline3.contour(1)));
+
+    // Empty contours are dropped, as when the engine is needed
+    outline1.moveTo(Point(50, 50));
+    outline3 = computeUnion(outline1, outline2);
+
+    ASSERT_EQ(2, outline3.numContours());
+}
+
+TEST_F(GeometryTest, naryUnion) {
+    ASSERT_TRUE(computeUnion(std::vector<Outline>()).empty());
+
+    std::vector<Outline> outlines;
+    for (int i = 0; i < 5; ++i) {
+        outlines.push_back(bezierSquare(20 * i, 0, 10));
+    }
+
+    Outline single = computeUnion(std::vector<Outline>(1, outlines[0]));
+    ASSERT_EQ(1, single.numContours());
+    ASSERT_TRUE(sameContour(outlines[0].contour(0), single.contour(0)));
+
+    Outline result = computeUnion(outlines);
+    ASSERT_EQ(5, result.numContours());
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(sameContour(outlines[i].contour(0), result.contour(i)));
+    }
+}
+
+TEST_F(GeometryTest, untouchedContoursPassThrough) {
+    Outline outline1 = bezierSquare(0, 0, 10);
+    outline1.append(bezierSquare(100, 0, 10));
+
+    Outline outline2 = bezierSquare(105, 5, 10);
+
+    Outline outline3 = computeUnion(outline1, outline2);
+
+    ASSERT_LE(2, outline3.numContours());
+    ASSERT_TRUE(sameContour(outline1.contour(0), outline3.contour(0)));
+
+    for (size_t i = 1; i < outline3.numContours(); ++i) {
+        ASSERT_LE(100 - FLOAT_PRECISION, outline3.contour(i).bbox().xmin);
+    }
+}
+
+static void appendSquare(Outline& outline, double x, double y, double size, bool ccw) {
+    outline.moveTo(Point(x, y));
+
+    if (ccw) {
+        outline.lineTo(Point(x + size, y));
+        outline.lineTo(Point(x + size, y + size));
+        outline.lineTo(Point(x, y + size));
+    }
+    else {
+        outline.lineTo(Point(x, y + size));
+        outline.lineTo(Point(x + size, y + size));
+        outline.lineTo(Point(x + size, y));
+    }
+
+    outline.closePath();
+}
+
+TEST_F(GeometryTest, nestedContoursPassThrough) {
+    Outline glyph = bezierSquare(0, 0, 100);
+    appendSquare(glyph, 20, 20, 60, false);
+
+    Outline watermark;
+    appendSquare(watermark, 200, 0, 20, true);
+
+    Outline outline3 = computeUnion(glyph, watermark);
+
+    ASSERT_EQ(3, outline3.numContours());
+    ASSERT_TRUE(sameContour(glyph.contour(0), outline3.contour(0)));
+    ASSERT_TRUE(sameContour(glyph.contour(1), outline3.contour(1)));
+    ASSERT_TRUE(sameContour(watermark.contour(0), outline3.contour(2)));
+}
+
+TEST_F(GeometryTest, containedContoursAreDropped) {
+    Outline glyph = bezierSquare(0, 0, 100);
+    Outline watermark;
+    appendSquare(watermark, 40, 40, 20, true);
+
+    Outline outline3 = computeUnion(glyph, watermark);
+
+    ASSERT_EQ(1, outline3.numContours());
+    ASSERT_TRUE(sameContour(glyph.contour(0), outline3.contour(0)));
+
+    outline3 = computeUnion(watermark, glyph);
+
+    ASSERT_EQ(1, outline3.numContours());
+    ASSERT_TRUE(sameContour(glyph.contour(0), outline3.contour(0)));
+}
+
+TEST_F(GeometryTest, contourInsideCounterIsKept) {
+    Outline glyph;
+    appendSquare(glyph, 0, 0, 100, true);
+    appendSquare(glyph, 20, 20, 60, false);
+
+    Outline watermark;
+    appendSquare(watermark, 40, 40, 20, true);
+
+    Outline outline3 = computeUnion(glyph, watermark);
+
+    ASSERT_EQ(3, outline3.numContours());
+}
+
+#ifdef APPROX_BEZIERS
+TEST_F(GeometryTest, overlappingContoursAreMerged) {
+    Outline glyph;
+    appendSquare(glyph, 0, 0, 10, true);
+    appendSquare(glyph, 5, 5, 10, true);
+
+    Outline watermark;
+    appendSquare(watermark, 100, 100, 10, true);
+
+    approx::USE_NATIVE_CLIPPER = true;
+    Outline outline3 = computeUnion(glyph, watermark);
+    approx::USE_NATIVE_CLIPPER = false;
+
+    // The glyph's squares overlap, so they are merged even though nothing
+    // from the watermark touches them
+    ASSERT_EQ(2, outline3.numContours());
+    ASSERT_TRUE(sameContour(watermark.contour(0), outline3.contour(0)));
+
+    BoundingBox box = outline3.contour(1).bbox();
+    ASSERT_EQ(0, box.xmin);
+    ASSERT_EQ(15, box.xmax);
+    ASSERT_EQ(8, outline3.contour(1).numVerbs);
+}
+#endif